@@ -26,10 +26,13 @@
 
 #include <gio/gio.h>
 #include <gst/gst.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <cairo.h>
 
 #include "gst-video-thumbnailer.h"
 
+/* Waits are done in steps of this, checking for cancellation in between */
+#define WAIT_STEP (GST_SECOND / 10)
+
 static void
 push_buffer (GstElement *element,
              GstBuffer  *out_buffer,
@@ -48,12 +51,63 @@ pull_buffer (GstElement *element,
              GstPad     *pad,
              GstBuffer **out_buffer)
 {
+    if (*out_buffer)
+        gst_buffer_unref (*out_buffer);
     *out_buffer = gst_buffer_ref (in_buffer);
 }
 
-GdkPixbuf *
-convert_buffer_to_pixbuf (GstBuffer    *buffer,
-                          GCancellable *cancellable)
+/* Caps for buffers laid out like cairo image surfaces of format, native
+ * endian 32 bit pixels. GStreamer describes them as big endian words. */
+static GstCaps *
+caps_for_cairo_format (cairo_format_t format,
+                       int            width,
+                       int            height)
+{
+    gboolean alpha = format == CAIRO_FORMAT_ARGB32;
+    GstCaps *caps;
+
+    caps = gst_caps_new_simple ("video/x-raw-rgb",
+                                "bpp", G_TYPE_INT, 32,
+                                "depth", G_TYPE_INT, alpha ? 32 : 24,
+                                "endianness", G_TYPE_INT, G_BIG_ENDIAN,
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                                "red_mask", G_TYPE_INT, 0x0000ff00,
+                                "green_mask", G_TYPE_INT, 0x00ff0000,
+                                "blue_mask", G_TYPE_INT, (gint) 0xff000000,
+#else
+                                "red_mask", G_TYPE_INT, 0x00ff0000,
+                                "green_mask", G_TYPE_INT, 0x0000ff00,
+                                "blue_mask", G_TYPE_INT, 0x000000ff,
+#endif
+                                "width", G_TYPE_INT, width,
+                                "height", G_TYPE_INT, height,
+                                "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+                                NULL);
+    if (alpha)
+        gst_caps_set_simple (caps,
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+                             "alpha_mask", G_TYPE_INT, 0x000000ff,
+#else
+                             "alpha_mask", G_TYPE_INT, (gint) 0xff000000,
+#endif
+                             NULL);
+
+    return caps;
+}
+
+static const cairo_user_data_key_t buffer_key;
+
+/* Converts buffer, a video frame, to an image surface of format, scaled
+ * to the size size_func picks for it. The pixels are converted and scaled
+ * in one go, straight into the memory the surface uses. Takes over the
+ * reference to buffer.
+ */
+static cairo_surface_t *
+convert_buffer (GstBuffer                   *buffer,
+                cairo_format_t               format,
+                GstVideoThumbnailerSizeFunc  size_func,
+                gpointer                     user_data,
+                GCancellable                *cancellable)
 {
     GstCaps *pb_caps;
     GstElement *pipeline;
@@ -62,21 +116,25 @@ convert_buffer_to_pixbuf (GstBuffer    *buffer,
     GstBus *bus;
     GstMessage *msg;
     GstStateChangeReturn state G_GNUC_UNUSED;
+    cairo_surface_t *surface = NULL;
     gboolean ret;
-    int dw, dh, i;
+    int dw, dh, sw, sh, par_n = 1, par_d = 1, i;
     GstStructure *s;
 
     s = gst_caps_get_structure (GST_BUFFER_CAPS (buffer), 0);
     gst_structure_get_int (s, "width", &dw);
     gst_structure_get_int (s, "height", &dh);
+    gst_structure_get_fraction (s, "pixel-aspect-ratio", &par_n, &par_d);
+
+    /* the size the frame is meant to be shown at */
+    if (par_n > 0 && par_d > 0)
+        dw = MAX (1, (gint64) dw * par_n / par_d);
+    sw = dw;
+    sh = dh;
+    if (size_func)
+        size_func (dw, dh, &sw, &sh, user_data);
 
-    pb_caps = gst_caps_new_simple ("video/x-raw-rgb",
-                                   "bpp", G_TYPE_INT, 24,
-                                   "depth", G_TYPE_INT, 24,
-                                   "width", G_TYPE_INT, dw,
-                                   "height", G_TYPE_INT, dh,
-                                   "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
-                                   NULL);
+    pb_caps = caps_for_cairo_format (format, sw, sh);
 
     pipeline = gst_pipeline_new ("pipeline");
 
@@ -108,73 +166,161 @@ convert_buffer_to_pixbuf (GstBuffer    *buffer,
     g_signal_connect (sink, "handoff",
                       G_CALLBACK (pull_buffer), &out_buffer);
 
-    ret = gst_element_link (src, colorspace);
-    if (ret == FALSE) {
-        g_warning ("Failed to link src->colorspace");
-        return NULL;
-    }
-
-    ret = gst_element_link (colorspace, scale);
-    if (ret == FALSE) {
-        g_warning ("Failed to link colorspace->scale");
-        return NULL;
-    }
-
-    ret = gst_element_link (scale, filter);
-    if (ret == FALSE) {
-        g_warning ("Failed to link scale->filter");
-        return NULL;
-    }
-
-    ret = gst_element_link (filter, sink);
+    ret = gst_element_link_many (src, colorspace, scale, filter, sink, NULL);
     if (ret == FALSE) {
-        g_warning ("Failed to link filter->sink");
+        g_warning ("Failed to link the conversion pipeline");
+        gst_object_unref (pipeline);
+        gst_caps_unref (pb_caps);
+        gst_buffer_unref (buffer);
         return NULL;
     }
 
     bus = gst_element_get_bus (GST_ELEMENT (pipeline));
     state = gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_PLAYING);
 
+    /* up to 5 seconds */
     i = 0;
     msg = NULL;
-    while (msg == NULL && i < 5) {
-        msg = gst_bus_timed_pop_filtered (bus, GST_SECOND,
+    while (msg == NULL && i < 50 && !g_cancellable_is_cancelled (cancellable)) {
+        msg = gst_bus_timed_pop_filtered (bus, WAIT_STEP,
                                           GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
         i++;
     }
 
     /* FIXME: Notify about error? */
-    gst_message_unref (msg);
+    if (msg)
+        gst_message_unref (msg);
 
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
     gst_caps_unref (pb_caps);
+    gst_buffer_unref (buffer);
 
-    if (out_buffer) {
-        GdkPixbuf *pixbuf;
-        char *data;
+    if (g_cancellable_is_cancelled (cancellable) && out_buffer) {
+        gst_buffer_unref (out_buffer);
+        out_buffer = NULL;
+    }
 
-        data = g_memdup (GST_BUFFER_DATA (out_buffer),
-                         GST_BUFFER_SIZE (out_buffer));
-        pixbuf = gdk_pixbuf_new_from_data ((guchar *) data,
-                                           GDK_COLORSPACE_RGB, FALSE,
-                                           8, dw, dh, GST_ROUND_UP_4 (dw * 3),
-                                           (GdkPixbufDestroyNotify) g_free,
-                                           NULL);
+    /* rows of 32 bit pixels are always as cairo wants them, so the surface
+     * can use the buffer as it is */
+    if (out_buffer &&
+        GST_BUFFER_SIZE (out_buffer) >= (guint) sw * sh * 4 &&
+        cairo_format_stride_for_width (format, sw) == sw * 4) {
+        surface = cairo_image_surface_create_for_data (GST_BUFFER_DATA (out_buffer),
+                                                       format, sw, sh, sw * 4);
+        cairo_surface_set_user_data (surface, &buffer_key, out_buffer,
+                                     (cairo_destroy_func_t) gst_buffer_unref);
+    } else if (out_buffer) {
+        gst_buffer_unref (out_buffer);
+    }
 
-        gst_buffer_unref (buffer);
-        return pixbuf;
+    return surface;
+}
+
+/* How many positions are tried to find a frame that is not black or all
+ * one colour, and where. Without a position given they are fractions of
+ * the duration, otherwise steps of POSTER_STEP after it. */
+#define POSTER_TRIES 4
+#define POSTER_STEP (2 * GST_SECOND)
+static const gdouble poster_positions[POSTER_TRIES] = { 0.33, 0.5, 0.15, 0.66 };
+
+/* The share of a frame taken by its two most common neighbouring
+ * brightnesses, in 16ths of the range, sampling every 4th pixel of every
+ * 4th row. Black frames, fades and plain title cards come close to 1.0.
+ */
+static gdouble
+frame_uniformity (cairo_surface_t *surface)
+{
+    guint hist[16] = { 0, };
+    guint count = 0, peak = 0;
+    const guchar *pixels;
+    const guint32 *p;
+    int width, height, stride, x, y, i;
+
+    pixels = cairo_image_surface_get_data (surface);
+    width = cairo_image_surface_get_width (surface);
+    height = cairo_image_surface_get_height (surface);
+    stride = cairo_image_surface_get_stride (surface);
+
+    for (y = 0; y < height; y += 4) {
+        p = (const guint32 *) (pixels + y * stride);
+        for (x = 0; x < width; x += 4, p += 4) {
+            /* BT.601 luma */
+            hist[(((*p >> 16) & 0xff) * 77 +
+                  ((*p >> 8) & 0xff) * 150 +
+                  (*p & 0xff) * 29) >> 12]++;
+            count++;
+        }
+    }
+
+    for (i = 0; i < 15; i++)
+        peak = MAX (peak, hist[i] + hist[i + 1]);
+
+    return count ? (gdouble) peak / count : 1.0;
+}
+
+/* Seeks to the keyframe at or before position and returns the frame shown
+ * there, or NULL. Keyframes decode by themselves, which makes this much
+ * faster than an accurate seek, and always gives the same frame.
+ */
+static cairo_surface_t *
+get_frame_at (GstElement                  *playbin,
+              gint64                       position,
+              cairo_format_t               format,
+              GstVideoThumbnailerSizeFunc  size_func,
+              gpointer                     user_data,
+              GCancellable                *cancellable)
+{
+    GstStateChangeReturn state;
+    GstBuffer *frame = NULL;
+    int count = 0;
+
+    gst_element_seek_simple (playbin, GST_FORMAT_TIME,
+                             GST_SEEK_FLAG_FLUSH |
+                             GST_SEEK_FLAG_KEY_UNIT, position);
+
+    /* Wait for seek to complete, up to 3 seconds */
+    state = gst_element_get_state (playbin, NULL, 0, 0.2 * GST_SECOND);
+    while (state == GST_STATE_CHANGE_ASYNC && count < 30
+           && !g_cancellable_is_cancelled (cancellable)) {
+        state = gst_element_get_state (playbin, NULL, 0, WAIT_STEP);
+        count++;
     }
 
-    /* FIXME: Check what buffers need freed */
-    return NULL;
+    if (state == GST_STATE_CHANGE_FAILURE ||
+        g_cancellable_is_cancelled (cancellable))
+        return NULL;
+
+    g_object_get (playbin,
+                  "frame", &frame,
+                  NULL);
+    if (frame == NULL)
+        return NULL;
+
+    return convert_buffer (frame, format, size_func, user_data, cancellable);
 }
 
-GdkPixbuf *
-gst_video_thumbnailer_get_shot (const gchar  *location,
-          GCancellable *cancellable)
+/* Takes a still of the video at location, at the keyframe nearest before
+ * position, in nanoseconds, or at a fixed point of the video if it is
+ * negative. Black and single coloured frames are skipped for a later one
+ * if possible, so the same video always gives the same still.
+ *
+ * The still is an image surface of format, CAIRO_FORMAT_RGB24 or
+ * CAIRO_FORMAT_ARGB32, sized by size_func if given and at the size the
+ * video is shown at otherwise.
+ */
+cairo_surface_t *
+gst_video_thumbnailer_get_shot (const gchar                 *location,
+                                gint64                       position,
+                                cairo_format_t               format,
+                                GstVideoThumbnailerSizeFunc  size_func,
+                                gpointer                     user_data,
+                                GCancellable                *cancellable)
 {
     GstElement *playbin, *audio_sink, *video_sink;
     GstStateChangeReturn state;
-    GdkPixbuf *shot = NULL;
+    cairo_surface_t *shot = NULL;
     int count = 0;
     gchar *uri = g_strconcat ("file://", location, NULL);
 
@@ -190,16 +336,19 @@ gst_video_thumbnailer_get_shot (const gchar  *location,
     g_object_set (video_sink,
                   "sync", TRUE,
                   NULL);
+    /* up to 5 seconds to preroll */
     state = gst_element_set_state (playbin, GST_STATE_PAUSED);
     while (state == GST_STATE_CHANGE_ASYNC
-           && count < 5
+           && count < 50
            && !g_cancellable_is_cancelled (cancellable)) {
-        state = gst_element_get_state (playbin, NULL, 0, 1 * GST_SECOND);
+        state = gst_element_get_state (playbin, NULL, 0, WAIT_STEP);
         count++;
 
-        /* Spin mainloop so we can pick up the cancels */
-        while (g_main_context_pending (NULL)) {
-            g_main_context_iteration (NULL, FALSE);
+        /* Spin mainloop so we can pick up the cancels, the thread default
+         * one so that this can run outside of the main thread */
+        while (g_main_context_pending (g_main_context_get_thread_default ())) {
+            g_main_context_iteration (g_main_context_get_thread_default (),
+                                      FALSE);
         }
     }
 
@@ -210,46 +359,46 @@ gst_video_thumbnailer_get_shot (const gchar  *location,
 
     if (state != GST_STATE_CHANGE_FAILURE &&
         state != GST_STATE_CHANGE_ASYNC) {
-        GstFormat format = GST_FORMAT_TIME;
-        gint64 duration;
-
-        if (gst_element_query_duration (playbin, &format, &duration)) {
-            gint64 seekpos;
-            GstBuffer *frame;
-
-            if (duration > 0) {
-                if (duration / (3 * GST_SECOND) > 90) {
-                    seekpos = (rand () % (duration / (3 * GST_SECOND))) * GST_SECOND;
-                } else {
-                    seekpos = (rand () % (duration / (GST_SECOND))) * GST_SECOND;
-                }
-            } else {
-                seekpos = 5 * GST_SECOND;
+        GstFormat time_format = GST_FORMAT_TIME;
+        gint64 duration = -1, seekpos;
+        gdouble uniformity, best = 2.0;
+        cairo_surface_t *frame;
+        int i;
+
+        if (!gst_element_query_duration (playbin, &time_format, &duration))
+            duration = -1;
+
+        for (i = 0; i < POSTER_TRIES && best > 0.9; i++) {
+            if (position >= 0)
+                seekpos = position + i * POSTER_STEP;
+            else if (duration > 0)
+                seekpos = duration * poster_positions[i];
+            else
+                seekpos = 5 * GST_SECOND + i * POSTER_STEP;
+            if (duration > 0 && seekpos >= duration) {
+                if (i > 0)
+                    break;
+                seekpos = duration - 1;
             }
 
-            gst_element_seek_simple (playbin, GST_FORMAT_TIME,
-                                     GST_SEEK_FLAG_FLUSH |
-                                     GST_SEEK_FLAG_ACCURATE, seekpos);
-
-            /* Wait for seek to complete */
-            count = 0;
-            state = gst_element_get_state (playbin, NULL, 0,
-                                           0.2 * GST_SECOND);
-            while (state == GST_STATE_CHANGE_ASYNC && count < 3) {
-                state = gst_element_get_state (playbin, NULL, 0, 1 * GST_SECOND);
-                count++;
-            }
-
-            g_object_get (playbin,
-                          "frame", &frame,
-                          NULL);
-            if (frame == NULL) {
-                g_warning ("No frame for %s", uri);
-                return NULL;
+            frame = get_frame_at (playbin, seekpos, format,
+                                  size_func, user_data, cancellable);
+            if (frame == NULL)
+                break;
+
+            uniformity = frame_uniformity (frame);
+            if (uniformity < best) {
+                if (shot)
+                    cairo_surface_destroy (shot);
+                shot = frame;
+                best = uniformity;
+            } else {
+                cairo_surface_destroy (frame);
             }
-
-            shot = convert_buffer_to_pixbuf (frame, cancellable);
         }
+
+        if (shot == NULL && !g_cancellable_is_cancelled (cancellable))
+            g_warning ("No frame for %s", uri);
     }
 
     gst_element_set_state (playbin, GST_STATE_NULL);
@@ -258,4 +407,96 @@ gst_video_thumbnailer_get_shot (const gchar  *location,
 
     return shot;
 }
+
+typedef struct {
+    gchar *location;
+    gint64 position;
+    cairo_format_t format;
+    GstVideoThumbnailerSizeFunc size_func;
+    gpointer size_data;
+    GDestroyNotify size_data_destroy;
+} GetShotData;
+
+static void
+get_shot_data_free (GetShotData *data)
+{
+    if (data->size_data_destroy)
+        data->size_data_destroy (data->size_data);
+    g_free (data->location);
+    g_slice_free (GetShotData, data);
+}
+
+static void
+get_shot_thread (GTask        *task,
+                 gpointer      source_object,
+                 gpointer      task_data,
+                 GCancellable *cancellable)
+{
+    GetShotData *data = task_data;
+    GMainContext *context;
+    cairo_surface_t *shot;
+
+    /* keep the waits from spinning the main context of the main thread */
+    context = g_main_context_new ();
+    g_main_context_push_thread_default (context);
+    shot = gst_video_thumbnailer_get_shot (data->location, data->position,
+                                           data->format, data->size_func,
+                                           data->size_data, cancellable);
+    g_main_context_pop_thread_default (context);
+    g_main_context_unref (context);
+
+    if (g_task_return_error_if_cancelled (task)) {
+        if (shot)
+            cairo_surface_destroy (shot);
+    } else if (shot) {
+        g_task_return_pointer (task, shot,
+                               (GDestroyNotify) cairo_surface_destroy);
+    } else {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                                 "Could not get a frame of %s",
+                                 data->location);
+    }
+}
+
+/* Gets a shot of the video at location in a thread of its own, several
+ * shots can be taken at the same time. size_func is called in that thread
+ * with size_data, which is kept until the thread is done with it even when
+ * cancelled. callback is called in the thread default main context of the
+ * caller, right away when cancelled.
+ */
+void
+gst_video_thumbnailer_get_shot_async (const gchar                 *location,
+                                      gint64                       position,
+                                      cairo_format_t               format,
+                                      GstVideoThumbnailerSizeFunc  size_func,
+                                      gpointer                     size_data,
+                                      GDestroyNotify               size_data_destroy,
+                                      GCancellable                *cancellable,
+                                      GAsyncReadyCallback          callback,
+                                      gpointer                     user_data)
+{
+    GetShotData *data;
+    GTask *task;
+
+    data = g_slice_new (GetShotData);
+    data->location = g_strdup (location);
+    data->position = position;
+    data->format = format;
+    data->size_func = size_func;
+    data->size_data = size_data;
+    data->size_data_destroy = size_data_destroy;
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_task_data (task, data, (GDestroyNotify) get_shot_data_free);
+    g_task_set_return_on_cancel (task, TRUE);
+    g_task_run_in_thread (task, get_shot_thread);
+    g_object_unref (task);
+}
+
+cairo_surface_t *
+gst_video_thumbnailer_get_shot_finish (GAsyncResult  *result,
+                                       GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
 #endif /* USE_CLUTTER_GST */
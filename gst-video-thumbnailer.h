@@ -23,5 +23,29 @@
 #include "config.h"
 #endif
 
-GdkPixbuf * gst_video_thumbnailer_get_shot (const gchar *location, GCancellable *cancellable);
+/* Picks the size a still of a video shown at width by height is taken at */
+typedef void (* GstVideoThumbnailerSizeFunc) (gint      width,
+                                              gint      height,
+                                              gint     *scaled_width,
+                                              gint     *scaled_height,
+                                              gpointer  user_data);
+
+cairo_surface_t * gst_video_thumbnailer_get_shot (const gchar                 *location,
+                                                  gint64                       position,
+                                                  cairo_format_t               format,
+                                                  GstVideoThumbnailerSizeFunc  size_func,
+                                                  gpointer                     user_data,
+                                                  GCancellable                *cancellable);
+
+void              gst_video_thumbnailer_get_shot_async  (const gchar                 *location,
+                                                         gint64                       position,
+                                                         cairo_format_t               format,
+                                                         GstVideoThumbnailerSizeFunc  size_func,
+                                                         gpointer                     size_data,
+                                                         GDestroyNotify               size_data_destroy,
+                                                         GCancellable                *cancellable,
+                                                         GAsyncReadyCallback          callback,
+                                                         gpointer                     user_data);
+cairo_surface_t * gst_video_thumbnailer_get_shot_finish (GAsyncResult                *result,
+                                                         GError                     **error);
 #endif
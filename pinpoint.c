@@ -27,18 +27,24 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <ctype.h>
 
 #include "pinpoint.h"
 
 #ifdef USE_CLUTTER_GST
 #include <clutter-gst/clutter-gst.h>
+#include <gst/gst.h>
 #endif
 
 /* Probably time to create a PinPointPresentation type */
 
-GList *pp_slides      = NULL; /* list of slide text */
-GList *pp_slidep      = NULL; /* current slide */
+/* how many slides around the current one are kept prepared */
+#define PP_PREPARE_BEHIND 2
+#define PP_PREPARE_AHEAD  2
+
+GPtrArray *pp_slides  = NULL; /* the slides, in presentation order */
+gint   pp_slideno     = -1;   /* index of the current slide */
 GFile *pp_basedir     = NULL; /* basedir to resolve relative paths against */
 
 typedef struct
@@ -82,9 +88,17 @@ static PinPointPoint pin_default_point = {
 
   .command = NULL,
 
+  .poster = -1,                             /* auto */
+
+  .camera_device = NULL,
   .camera_framerate = 0,                    /* auto */
   .camera_resolution = {0, 0},              /* auto */
 
+  .prefetch = 2,
+
+  .source = NULL,
+  .prepared = FALSE,
+
   .data = NULL,
 };
 
@@ -98,6 +112,10 @@ gboolean  pp_maximized       = FALSE;
 gboolean  pp_speakermode     = FALSE;
 gboolean  pp_rehearse        = FALSE;
 char     *pp_camera_device   = NULL;
+gint      pp_prefetch        = -1;       /* -1: use [prefetch=] */
+gboolean  pp_preload_transitions = FALSE;
+gint      pp_memory_limit    = 1024;     /* MiB */
+gint      pp_video_pipelines = 3;
 
 static GOptionEntry entries[] =
 {
@@ -116,7 +134,20 @@ static GOptionEntry entries[] =
       "Output presentation to FILE\n"
 "                                         (formats supported: pdf)", "FILE" },
     { "camera", 'c', 0, G_OPTION_ARG_STRING, &pp_camera_device,
-      "Device to use for [camera] background", "DEVICE" },
+      "Device to use for [camera] backgrounds without\n"
+"                                         [camera-device=]", "DEVICE" },
+    { "prefetch", 'p', 0, G_OPTION_ARG_INT, &pp_prefetch,
+      "Decode the backgrounds of the next N slides\n"
+"                                         ahead of time (default: 2)", "N" },
+    { "preload-transitions", 0, 0, G_OPTION_ARG_NONE, &pp_preload_transitions,
+      "Load all transitions used at startup", NULL },
+    { "memory-limit", 0, 0, G_OPTION_ARG_INT, &pp_memory_limit,
+      "Keep at most MB megabytes of decoded images\n"
+"                                         around when exporting (default: 1024)",
+      "MB" },
+    { "video-pipelines", 0, 0, G_OPTION_ARG_INT, &pp_video_pipelines,
+      "Keep at most N video decoders running\n"
+"                                         (default: 3)", "N" },
     { NULL }
 };
 
@@ -128,12 +159,13 @@ static char * pp_serialize (void);
 
 void pp_rehearse_init (void)
 {
-  GList *iter;
-  for (iter = pp_slides; iter; iter=iter->next)
+  guint i;
+  for (i = 0; i < pp_slide_count (); i++)
     {
-      PinPointPoint *point = iter->data;
+      PinPointPoint *point = pp_slide_nth (i);
       point->new_duration = 0.0;
     }
+  pp_timing_update ();
 }
 
 
@@ -157,15 +189,47 @@ static void pp_rehearse_save (void)
 
 void pp_rehearse_done (void)
 {
-  GList *iter;
-  for (iter = pp_slides; iter; iter=iter->next)
+  guint i;
+  for (i = 0; i < pp_slide_count (); i++)
     {
-      PinPointPoint *point = iter->data;
+      PinPointPoint *point = pp_slide_nth (i);
       point->duration = point->new_duration;
     }
+  pp_timing_update ();
   pp_rehearse_save ();
 }
 
+static gboolean
+pp_is_pdf_output (const char *filename)
+{
+  return filename && g_str_has_suffix (filename, ".pdf");
+}
+
+/* Looks for --output before the options are parsed, so that Clutter and
+ * Cogl are kept out of the way when only exporting to PDF, which then also
+ * works without a display.
+ */
+static gboolean
+pp_prescan_pdf_output (int    argc,
+                       char **argv)
+{
+  const char *output = NULL;
+  int         i;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (g_str_equal (argv[i], "--"))
+        break;
+      if ((g_str_equal (argv[i], "-o") || g_str_equal (argv[i], "--output")) &&
+          i + 1 < argc)
+        output = argv[++i];
+      else if (g_str_has_prefix (argv[i], "--output="))
+        output = argv[i] + strlen ("--output=");
+    }
+
+  return pp_is_pdf_output (output);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -174,14 +238,20 @@ main (int    argc,
   GOptionContext   *context;
   GError *error = NULL;
   char   *text  = NULL;
+  gboolean headless;
 
   memcpy (&default_point, &pin_default_point, sizeof (default_point));
   renderer = pp_clutter_renderer ();
+  headless = pp_prescan_pdf_output (argc, argv);
 
   context = g_option_context_new ("- Presentations made easy");
   g_option_context_add_main_entries (context, entries, NULL);
-  g_option_context_add_group (context, clutter_get_option_group_without_init ());
-  g_option_context_add_group (context, cogl_get_option_group ());
+  if (!headless)
+    {
+      g_option_context_add_group (context,
+                                  clutter_get_option_group_without_init ());
+      g_option_context_add_group (context, cogl_get_option_group ());
+    }
   if (!g_option_context_parse (context, &argc, &argv, &error))
     {
       g_print ("option parsing failed: %s\n", error->message);
@@ -206,25 +276,31 @@ main (int    argc,
         }
     }
 
-#ifdef USE_CLUTTER_GST
-  clutter_gst_init (&argc, &argv);
-#else
-  clutter_init (&argc, &argv);
-#endif
-#ifdef USE_DAX
-  dax_init (&argc, &argv);
-#endif
-
-  /* select the cairo renderer if we have requested pdf output */
-  if (pp_output_filename && g_str_has_suffix (pp_output_filename, ".pdf"))
+  /* select the cairo renderer if we have requested pdf output, it does
+   * not need Clutter (GStreamer is still used for video thumbnails) */
+  if (pp_is_pdf_output (pp_output_filename))
     {
 #ifdef HAVE_PDF
+#ifdef USE_CLUTTER_GST
+      gst_init (&argc, &argv);
+#endif
       renderer = pp_cairo_renderer ();
       /* makes more sense to default to a white "stage" colour in PDFs*/
       default_point.stage_color = "white";
 #else
       g_warning ("Pinpoint was built without PDF support");
       return EXIT_FAILURE;
+#endif
+    }
+  else
+    {
+#ifdef USE_CLUTTER_GST
+      clutter_gst_init (&argc, &argv);
+#else
+      clutter_init (&argc, &argv);
+#endif
+#ifdef USE_DAX
+      dax_init (&argc, &argv);
 #endif
     }
 
@@ -258,7 +334,8 @@ main (int    argc,
     pp_rehearse_save ();
 #endif
 
-  g_list_free (pp_slides);
+  if (pp_slides)
+    g_ptr_array_free (pp_slides, TRUE);
 
   return 0;
 }
@@ -266,6 +343,197 @@ main (int    argc,
 /*********************/
 
 
+/*
+ * Slide access
+ */
+
+guint
+pp_slide_count (void)
+{
+  return pp_slides ? pp_slides->len : 0;
+}
+
+PinPointPoint *
+pp_slide_nth (gint slideno)
+{
+  if (slideno < 0 || slideno >= (gint) pp_slide_count ())
+    return NULL;
+  return g_ptr_array_index (pp_slides, slideno);
+}
+
+PinPointPoint *
+pp_slide_current (void)
+{
+  return pp_slide_nth (pp_slideno);
+}
+
+static PinPointRenderer *prepare_renderer = NULL;
+static guint             prepare_idle     = 0;
+
+/* Prepares the nearest slide around the current one that is not prepared
+ * yet, one per iteration so input and redraws are not held up.
+ */
+static gboolean
+pp_slides_prepare_idle (gpointer user_data)
+{
+  PinPointRenderer *renderer = prepare_renderer;
+  gint              d;
+
+  for (d = 1; d <= MAX (PP_PREPARE_BEHIND, PP_PREPARE_AHEAD); d++)
+    {
+      PinPointPoint *ahead  = d <= PP_PREPARE_AHEAD ?
+                                pp_slide_nth (pp_slideno + d) : NULL;
+      PinPointPoint *behind = d <= PP_PREPARE_BEHIND ?
+                                pp_slide_nth (pp_slideno - d) : NULL;
+      PinPointPoint *point;
+
+      if (ahead && !ahead->prepared)
+        point = ahead;
+      else if (behind && !behind->prepared)
+        point = behind;
+      else
+        continue;
+
+      renderer->prepare_point (renderer, point);
+      point->prepared = TRUE;
+      return TRUE;
+    }
+
+  prepare_idle = 0;
+  return FALSE;
+}
+
+/* Has the renderer keep the slides from PP_PREPARE_BEHIND before to
+ * PP_PREPARE_AHEAD after the current one prepared, releasing the others.
+ * Only the current slide is prepared right away, its neighbours are
+ * prepared from an idle callback.
+ */
+void
+pp_slides_prepare (PinPointRenderer *renderer)
+{
+  PinPointPoint *current = pp_slide_current ();
+  guint          i;
+
+  if (!renderer->prepare_point)
+    return;
+
+  if (current && !current->prepared)
+    {
+      renderer->prepare_point (renderer, current);
+      current->prepared = TRUE;
+    }
+
+  for (i = 0; i < pp_slide_count (); i++)
+    {
+      PinPointPoint *point = pp_slide_nth (i);
+
+      if (point->prepared &&
+          ((gint) i < pp_slideno - PP_PREPARE_BEHIND ||
+           (gint) i > pp_slideno + PP_PREPARE_AHEAD))
+        {
+          if (renderer->release_point)
+            renderer->release_point (renderer, point);
+          point->prepared = FALSE;
+        }
+    }
+
+  prepare_renderer = renderer;
+  if (!prepare_idle)
+    prepare_idle = g_idle_add_full (G_PRIORITY_LOW, pp_slides_prepare_idle,
+                                    NULL, NULL);
+}
+
+/*
+ * Timing
+ *
+ * Prefix sums of the planned and rehearsed slide durations, entry i holds
+ * the time of all slides before slide i.
+ */
+
+static gdouble *planned_sums   = NULL;
+static gdouble *rehearsed_sums = NULL;
+
+static gfloat
+planned_duration (PinPointPoint *point)
+{
+  return point->duration != 0.0 ? point->duration : 2.0;
+}
+
+static gfloat
+rehearsed_duration (PinPointPoint *point)
+{
+  return point->new_duration != 0.0 ? point->new_duration
+                                    : planned_duration (point);
+}
+
+void
+pp_timing_update (void)
+{
+  guint n = pp_slide_count ();
+  guint i;
+
+  planned_sums = g_renew (gdouble, planned_sums, n + 1);
+  rehearsed_sums = g_renew (gdouble, rehearsed_sums, n + 1);
+
+  planned_sums[0] = rehearsed_sums[0] = 0.0;
+  for (i = 0; i < n; i++)
+    {
+      PinPointPoint *point = pp_slide_nth (i);
+
+      planned_sums[i + 1] = planned_sums[i] + planned_duration (point);
+      rehearsed_sums[i + 1] = rehearsed_sums[i] + rehearsed_duration (point);
+    }
+}
+
+void
+pp_slide_set_new_duration (gint   slideno,
+                           gfloat new_duration)
+{
+  PinPointPoint *point = pp_slide_nth (slideno);
+  gdouble        delta;
+  guint          i;
+
+  if (!point)
+    return;
+
+  delta = -rehearsed_duration (point);
+  point->new_duration = new_duration;
+  delta += rehearsed_duration (point);
+
+  for (i = slideno + 1; i <= pp_slide_count (); i++)
+    rehearsed_sums[i] += delta;
+}
+
+gfloat
+pp_timing_start (gint slideno)
+{
+  /* rehearsed times are used up to and including the current slide */
+  gint split = CLAMP (pp_slideno + 1, 0, (gint) pp_slide_count ());
+
+  slideno = CLAMP (slideno, 0, (gint) pp_slide_count ());
+  if (slideno <= split)
+    return rehearsed_sums[slideno];
+  return rehearsed_sums[split] + planned_sums[slideno] - planned_sums[split];
+}
+
+gfloat
+pp_timing_slide (gint slideno)
+{
+  return pp_timing_start (slideno + 1) - pp_timing_start (slideno);
+}
+
+gfloat
+pp_timing_total (void)
+{
+  return pp_timing_start (pp_slide_count ());
+}
+
+gfloat
+pp_timing_remaining (gint slideno)
+{
+  return pp_timing_total () - pp_timing_start (slideno);
+}
+
 /*
  * Cross-renderer helpers
  */
@@ -314,6 +582,29 @@ pp_get_background_position_scale (PinPointPoint *point,
   *bg_y = (stage_height - bg_height * *bg_scale_y) / 2;
 }
 
+/* The smallest size a background of bg_width x bg_height can be decoded at
+ * while still having a pixel for every stage pixel it covers; never larger
+ * than the image itself.
+ */
+void
+pp_get_background_decode_size (PinPointPoint *point,
+                               float          stage_width,
+                               float          stage_height,
+                               int            bg_width,
+                               int            bg_height,
+                               int           *decode_width,
+                               int           *decode_height)
+{
+  float bg_x, bg_y, bg_scale_x, bg_scale_y;
+
+  pp_get_background_position_scale (point, stage_width, stage_height,
+                                    bg_width, bg_height,
+                                    &bg_x, &bg_y, &bg_scale_x, &bg_scale_y);
+
+  *decode_width  = CLAMP (bg_width * bg_scale_x + 0.5, 1, bg_width);
+  *decode_height = CLAMP (bg_height * bg_scale_y + 0.5, 1, bg_height);
+}
+
 void
 pp_get_text_position_scale (PinPointPoint *point,
                             float          stage_width,
@@ -458,8 +749,11 @@ parse_setting (PinPointPoint *point,
   IF_PREFIX("duration=")   point->duration = FLOAT;
   IF_PREFIX("command=")    point->command = STRING;
   IF_PREFIX("transition=") point->transition = STRING;
+  IF_PREFIX("poster=")     point->poster = FLOAT;
+  IF_PREFIX("camera-device=")     point->camera_device = STRING;
   IF_PREFIX("camera-framerate=")  point->camera_framerate = INT;
   IF_PREFIX("camera-resolution=") RESOLUTION (point->camera_resolution);
+  IF_PREFIX("prefetch=")   point->prefetch = INT;
   IF_EQUAL("fill")         point->bg_scale = PP_BG_FILL;
   IF_EQUAL("fit")          point->bg_scale = PP_BG_FIT;
   IF_EQUAL("stretch")      point->bg_scale = PP_BG_STRETCH;
@@ -521,12 +815,15 @@ static void
 pin_point_free (PinPointRenderer *renderer,
                 PinPointPoint    *point)
 {
+  if (point->prepared && renderer->release_point)
+    renderer->release_point (renderer, point);
   if (renderer->free_data)
     renderer->free_data (renderer, point->data);
   if (point->speaker_notes)
     {
       g_free (point->speaker_notes);
     }
+  g_free (point->source);
   g_free (point);
 }
 
@@ -544,11 +841,120 @@ pin_point_new (PinPointRenderer *renderer)
   return point;
 }
 
+static double
+pp_hue_to_rgb (double m1,
+               double m2,
+               double hue)
+{
+  hue -= (gint) hue;
+  if (hue < 0.0)
+    hue += 1.0;
+  if (hue < 1.0 / 6.0)
+    return m1 + (m2 - m1) * hue * 6.0;
+  if (hue < 1.0 / 2.0)
+    return m2;
+  if (hue < 2.0 / 3.0)
+    return m1 + (m2 - m1) * (2.0 / 3.0 - hue) * 6.0;
+  return m1;
+}
+
+/* Parses the same colour syntax as clutter_color_from_string (): named and
+ * #rgb / #rgba / #rrggbb / #rrggbbaa colours and the CSS rgb(), rgba(),
+ * hsl() and hsla() notations, without needing Clutter to be initialized.
+ */
+gboolean
+pp_color_from_string (PPColor    *color,
+                      const char *string)
+{
+  PangoColor pango_color;
+  double     a = 1.0, b, c, d;
+  char       close;
+
+  g_return_val_if_fail (string != NULL, FALSE);
+
+  while (g_ascii_isspace (*string))
+    string++;
+
+  if (sscanf (string, "rgba ( %lf , %lf , %lf , %lf %c", &b, &c, &d, &a,
+              &close) == 5 ||
+      sscanf (string, "rgb ( %lf , %lf , %lf %c", &b, &c, &d, &close) == 4)
+    {
+      if (close != ')')
+        return FALSE;
+      color->red   = CLAMP (b, 0, 255) / 255.0;
+      color->green = CLAMP (c, 0, 255) / 255.0;
+      color->blue  = CLAMP (d, 0, 255) / 255.0;
+      color->alpha = CLAMP (a, 0, 1);
+      return TRUE;
+    }
+
+  if (sscanf (string, "hsla ( %lf , %lf%% , %lf%% , %lf %c", &b, &c, &d, &a,
+              &close) == 5 ||
+      sscanf (string, "hsl ( %lf , %lf%% , %lf%% %c", &b, &c, &d,
+              &close) == 4)
+    {
+      double m1, m2;
+
+      if (close != ')')
+        return FALSE;
+      b /= 360.0;
+      c = CLAMP (c, 0, 100) / 100.0;
+      d = CLAMP (d, 0, 100) / 100.0;
+      m2 = d <= 0.5 ? d * (c + 1.0) : d + c - d * c;
+      m1 = d * 2.0 - m2;
+      color->red   = pp_hue_to_rgb (m1, m2, b + 1.0 / 3.0);
+      color->green = pp_hue_to_rgb (m1, m2, b);
+      color->blue  = pp_hue_to_rgb (m1, m2, b - 1.0 / 3.0);
+      color->alpha = CLAMP (a, 0, 1);
+      return TRUE;
+    }
+
+  /* pango does not know about alpha */
+  if (string[0] == '#')
+    {
+      gsize len = strlen (string + 1);
+      gsize i;
+
+      for (i = 1; i <= len; i++)
+        if (!g_ascii_isxdigit (string[i]))
+          return FALSE;
+
+      if (len == 4 || len == 8)
+        {
+          char *rgb = g_strndup (string, len / 4 * 3 + 1);
+          gint  alpha;
+
+          if (len == 4)
+            alpha = g_ascii_xdigit_value (string[4]) * 0x11;
+          else
+            alpha = g_ascii_xdigit_value (string[7]) * 0x10 +
+                    g_ascii_xdigit_value (string[8]);
+          if (!pango_color_parse (&pango_color, rgb))
+            {
+              g_free (rgb);
+              return FALSE;
+            }
+          g_free (rgb);
+          a = alpha / 255.0;
+        }
+      else if (!pango_color_parse (&pango_color, string))
+        return FALSE;
+    }
+  else if (!pango_color_parse (&pango_color, string))
+    return FALSE;
+
+  color->red   = pango_color.red   / 65535.0;
+  color->green = pango_color.green / 65535.0;
+  color->blue  = pango_color.blue  / 65535.0;
+  color->alpha = a;
+  return TRUE;
+}
+
 static gboolean
 pp_is_color (const char *string)
 {
-  ClutterColor color;
-  return clutter_color_from_string (&color, string);
+  PPColor color;
+  return pp_color_from_string (&color, string);
 }
 
 static gboolean
@@ -646,7 +1052,10 @@ static void serialize_slide_config (GString       *str,
   if (point->duration != 0.0)
     FLOAT(duration, "duration="); /* XXX: probably needs special treatment */
 
+  FLOAT(poster, "poster=");
+  STRING(camera_device, "camera-device=");
   INT(camera_framerate, "camera-framerate=");
+  INT(prefetch, "prefetch=");
   if (point->camera_resolution.width != reference->camera_resolution.width &&
       point->camera_resolution.height != reference->camera_resolution.height)
     {
@@ -704,24 +1113,80 @@ static char * pp_serialize (void)
 {
   GString *str = g_string_new ("#!/usr/bin/env pinpoint\n");
   char *ret;
-  GList *iter;
+  guint i;
 
   serialize_slide_config (str, &default_point, &pin_default_point, "\n");
 
-  for (iter = pp_slides; iter; iter = iter->next)
+  for (i = 0; i < pp_slide_count (); i++)
     {
-      serialize_slide (str, iter->data);
+      serialize_slide (str, pp_slide_nth (i));
     }
   ret = str->str;
   g_string_free (str, FALSE);
   return ret;
 }
 
+static PinPointPoint *
+pin_point_build (PinPointRenderer *renderer,
+                 const char       *config,
+                 GString          *slide_str,
+                 GString          *notes_str)
+{
+  PinPointPoint *point = pin_point_new (renderer);
+
+  parse_config (point, config);
+
+  if (point->bg && point->bg[0])
+    {
+      char *filename = g_strdup (point->bg);
+      int i = 0;
+
+      while (filename[i])
+        {
+          filename[i] = tolower(filename[i]);
+          i++;
+        }
+
+      if (strcmp (filename, "camera") == 0)
+        point->bg_type = PP_BG_CAMERA;
+      else if (str_has_video_suffix (filename))
+        point->bg_type = PP_BG_VIDEO;
+      else if (g_str_has_suffix (filename, ".svg"))
+        point->bg_type = PP_BG_SVG;
+      else if (pp_is_color (point->bg))
+        point->bg_type = PP_BG_COLOR;
+      else
+        point->bg_type = PP_BG_IMAGE;
+      g_free (filename);
+    }
+
+  {
+    char *str = slide_str->str;
+
+  /* trim newlines from start and end. ' ' can be used in the
+   * insane case that you actually want blank lines before or
+   * after the text of a slide */
+    while (*str == '\n') str++;
+    while (slide_str->len && slide_str->str[slide_str->len - 1] == '\n')
+      g_string_truncate (slide_str, slide_str->len - 1);
+
+    point->text = g_intern_string (str);
+  }
+  if (notes_str->str[0])
+    point->speaker_notes = g_strdup (notes_str->str);
+
+  renderer->make_point (renderer, point);
+
+  return point;
+}
+
 void
 pp_parse_slides (PinPointRenderer *renderer,
                  const char       *slide_src)
 {
   const char *p;
+  const char *slide_start = slide_src; /* where the source of the slide being
+                                          parsed starts */
   int         slideno     = 0;
   gboolean    done        = FALSE;
   gboolean    startofline = TRUE;
@@ -729,49 +1194,18 @@ pp_parse_slides (PinPointRenderer *renderer,
   GString    *slide_str   = g_string_new ("");
   GString    *setting_str = g_string_new ("");
   GString    *notes_str   = g_string_new ("");
-  GList      *s;
-  PinPointPoint *point, *next_point;
-
-  if (renderer->source)
-    {
-      gboolean start_of_line = TRUE;
-      int pos;
-      int lineno=0;
-      /* compute slide no that has changed */
-      for (pos = 0, slideno = 0;
-           slide_src[pos] &&
-           renderer->source[pos] &&
-           slide_src[pos]==renderer->source[pos]
-           ; pos ++)
-        {
-          switch (slide_src[pos])
-            {
-              case '\n':
-                start_of_line = TRUE;
-                lineno++;
-                break;
-              case '-':
-                if (start_of_line)
-                  slideno++;
-              default:
-                start_of_line = FALSE;
-            }
-        }
-      slideno-=1;
-      g_free (renderer->source);
-    }
-  renderer->source = g_strdup (slide_src);
+  GPtrArray  *old_slides  = pp_slides;
+  GHashTable *reusable;      /* slide source -> list of points built from it */
+  GHashTableIter iter;
+  gpointer    value;
+  gint        i;
 
-  for (s = pp_slides; s; s = s->next)
-    pin_point_free (renderer, s->data);
-
-  g_list_free (pp_slides);
-  pp_slides = NULL;
-  point = pin_point_new (renderer);
+  reusable = g_hash_table_new (g_str_hash, g_str_equal);
+  pp_slides = g_ptr_array_new ();
 
   /* parse the slides, constructing lists of slide/point objects
    */
-  for (p = slide_src; *p; p++)
+  for (p = slide_src; !done; p++)
     {
       switch (*p)
         {
@@ -780,89 +1214,85 @@ pp_parse_slides (PinPointRenderer *renderer,
             startofline = FALSE;
             if (*p)
               g_string_append_c (slide_str, *p);
+            else
+              p--;
             break;
           case '\n':
             startofline = TRUE;
             g_string_append_c (slide_str, *p);
             break;
+          case '\0': /* end of input, close the last slide */
+            done = TRUE;
+            /* flow through */
           case '-': /* slide seperator */
-            close_last_slide:
             if (startofline)
               {
                 startofline = FALSE;
-                next_point = pin_point_new (renderer);
-
-                g_string_assign (setting_str, "");
-                while (*p && *p!='\n')  /* until newline */
-                  {
-                    g_string_append_c (setting_str, *p);
-                    p++;
-                  }
-                parse_config (next_point, setting_str->str);
 
                 if (!gotconfig)
                   {
+                    char *header = g_strndup (slide_src, p - slide_src);
+
                     parse_config (&default_point, slide_str->str);
-                    /* copy the default point except the per-slide allocated
-                     * data (void *) */
-                    memcpy (point, &default_point,
-                            sizeof (PinPointPoint) - sizeof (void *));
-                    parse_config (point, setting_str->str);
+
+                    /* slides are only kept across reparses when the
+                     * defaults they were built with did not change */
+                    if (old_slides && renderer->source &&
+                        g_str_equal (renderer->source, header))
+                      {
+                        for (i = old_slides->len - 1; i >= 0; i--)
+                          {
+                            PinPointPoint *point = old_slides->pdata[i];
+                            GList *list;
+
+                            list = g_hash_table_lookup (reusable, point->source);
+                            g_hash_table_insert (reusable, point->source,
+                                                 g_list_prepend (list, point));
+                          }
+                      }
+                    g_free (renderer->source);
+                    renderer->source = header;
                     gotconfig = TRUE;
-                    g_string_assign (slide_str, "");
-                    g_string_assign (setting_str, "");
-                    g_string_assign (notes_str, "");
                   }
                 else
                   {
-                    if (point->bg && point->bg[0])
-                      {
-                        char *filename = g_strdup (point->bg);
-                        int i = 0;
+                    PinPointPoint *point;
+                    char          *source;
+                    GList         *list;
 
-                        while (filename[i])
-                          {
-                            filename[i] = tolower(filename[i]);
-                            i++;
-                          }
+                    source = g_strndup (slide_start, p - slide_start);
+                    list = g_hash_table_lookup (reusable, source);
 
-                        if (strcmp (filename, "camera") == 0)
-                          point->bg_type = PP_BG_CAMERA;
-                        else if (str_has_video_suffix (filename))
-                          point->bg_type = PP_BG_VIDEO;
-                        else if (g_str_has_suffix (filename, ".svg"))
-                          point->bg_type = PP_BG_SVG;
-                        else if (pp_is_color (point->bg))
-                          point->bg_type = PP_BG_COLOR;
-                        else
-                          point->bg_type = PP_BG_IMAGE;
-                        g_free (filename);
+                    if (list)
+                      {
+                        /* unchanged slide, keep it and its renderer data */
+                        point = list->data;
+                        g_hash_table_insert (reusable, point->source,
+                                             g_list_delete_link (list, list));
+                        g_free (source);
+                      }
+                    else
+                      {
+                        point = pin_point_build (renderer, setting_str->str,
+                                                 slide_str, notes_str);
+                        point->source = source;
                       }
 
-                    {
-                      char *str = slide_str->str;
-
-                    /* trim newlines from start and end. ' ' can be used in the
-                     * insane case that you actually want blank lines before or
-                     * after the text of a slide */
-                      while (*str == '\n') str++;
-                      while ( slide_str->str[strlen(slide_str->str)-1]=='\n')
-                        slide_str->str[strlen(slide_str->str)-1]='\0';
-
-                      point->text = g_intern_string (str);
-                    }
-                    if (notes_str->str[0])
-                      point->speaker_notes = g_strdup (notes_str->str);
-
-                    renderer->make_point (renderer, point);
+                    g_ptr_array_add (pp_slides, point);
+                  }
 
-                    g_string_assign (slide_str, "");
-                    g_string_assign (setting_str, "");
-                    g_string_assign (notes_str, "");
+                g_string_assign (slide_str, "");
+                g_string_assign (setting_str, "");
+                g_string_assign (notes_str, "");
 
-                    pp_slides = g_list_append (pp_slides, point);
-                    point = next_point;
+                slide_start = p;
+                while (*p && *p!='\n')  /* until newline */
+                  {
+                    g_string_append_c (setting_str, *p);
+                    p++;
                   }
+                if (!*p && !done)
+                  p--;
               }
             else
               {
@@ -878,12 +1308,9 @@ pp_parse_slides (PinPointRenderer *renderer,
                   g_string_append_c (notes_str, *end);
                   end++;
                 }
-              if (end)
-                {
-                  g_string_append_c (notes_str, '\n');
-                  p = end;
-                  break;
-                }
+              g_string_append_c (notes_str, '\n');
+              p = *end ? end : end - 1;
+              break;
             }
           /* flow through */
           default:
@@ -893,18 +1320,42 @@ pp_parse_slides (PinPointRenderer *renderer,
         }
     }
 
-  if (!done)
-    {
-      done = TRUE;
-      goto close_last_slide;
-    }
-
   g_string_free (slide_str, TRUE);
   g_string_free (setting_str, TRUE);
   g_string_free (notes_str, TRUE);
 
-  if (g_list_nth (pp_slides, slideno))
-    pp_slidep = g_list_nth (pp_slides, slideno);
-  else
-    pp_slidep = pp_slides;
+  /* show the first slide that was added, removed or edited, stay on the
+   * current one if nothing changed */
+  if (old_slides)
+    {
+      while (slideno < (gint) pp_slides->len &&
+             slideno < (gint) old_slides->len &&
+             pp_slides->pdata[slideno] == old_slides->pdata[slideno])
+        slideno++;
+      if (pp_slides->len == old_slides->len && slideno == (gint) pp_slides->len)
+        slideno = pp_slideno;
+    }
+
+  g_hash_table_iter_init (&iter, reusable);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_list_free (value);
+  g_hash_table_destroy (reusable);
+
+  /* whatever was not reused is gone from the source, or was built with
+   * other defaults */
+  if (old_slides)
+    {
+      GHashTable *kept = g_hash_table_new (NULL, NULL);
+
+      for (i = 0; i < (gint) pp_slides->len; i++)
+        g_hash_table_add (kept, pp_slides->pdata[i]);
+      for (i = 0; i < (gint) old_slides->len; i++)
+        if (!g_hash_table_contains (kept, old_slides->pdata[i]))
+          pin_point_free (renderer, old_slides->pdata[i]);
+      g_hash_table_destroy (kept);
+      g_ptr_array_free (old_slides, TRUE);
+    }
+
+  pp_slideno = MIN (slideno, (gint) pp_slides->len - 1);
+  pp_timing_update ();
 }
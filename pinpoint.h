@@ -63,6 +63,11 @@ typedef struct
   gint width, height;
 } PPResolution;
 
+typedef struct
+{
+  double red, green, blue, alpha;   /* 0.0 - 1.0 */
+} PPColor;
+
 #define PINPOINT_RENDERER(renderer) ((PinPointRenderer *) renderer)
 
 struct _PinPointRenderer
@@ -76,7 +81,14 @@ struct _PinPointRenderer
   void *    (*allocate_data) (PinPointRenderer *renderer);
   void      (*free_data)     (PinPointRenderer *renderer,
                               void             *datap);
-  char *      source;
+  /* optional, set up and drop what is only needed for showing a slide;
+   * only the slides around the current one are kept prepared */
+  void      (*prepare_point) (PinPointRenderer *renderer,
+                              PinPointPoint    *point);
+  void      (*release_point) (PinPointRenderer *renderer,
+                              PinPointPoint    *point);
+  char *      source;        /* the defaults the current slides were
+                                parsed with */
 };
 
 struct _PinPointPoint
@@ -108,9 +120,21 @@ struct _PinPointPoint
 
   const char        *command;
 
+  gfloat            poster;           /* seconds into the video to take
+                                         stills at, negative for automatic */
+
+  const char       *camera_device;    /* NULL for --camera or the default */
   gint              camera_framerate;
   PPResolution      camera_resolution;
 
+  gint              prefetch;         /* how many upcoming slides to decode
+                                         backgrounds for, only used from the
+                                         presentation defaults */
+
+  char              *source;          /* the slide's source text, used to
+                                         reuse unchanged slides on reparse */
+  gboolean           prepared;        /* prepare_point () has been called */
+
   void              *data;            /* the renderer can attach data here */
 };
 
@@ -120,15 +144,28 @@ extern gboolean  pp_maximized;
 extern gboolean  pp_speakermode;
 extern gboolean  pp_rehearse;
 extern char     *pp_camera_device;
+extern gint      pp_prefetch;
+extern gboolean  pp_preload_transitions;
+extern gint      pp_memory_limit;
+extern gint      pp_video_pipelines;
 
-extern GList         *pp_slides;  /* list of slide text */
-extern GList         *pp_slidep;  /* current slide */
+extern GPtrArray     *pp_slides;  /* the slides, in presentation order */
+extern gint           pp_slideno; /* index of the current slide, -1 if none */
 extern GFile         *pp_basedir;
 extern PinPointPoint *point_defaults;
 
 void     pp_parse_slides  (PinPointRenderer *renderer,
                            const char       *slide_src);
 
+void           pp_slides_prepare (PinPointRenderer *renderer);
+
+guint          pp_slide_count   (void);
+PinPointPoint *pp_slide_nth     (gint slideno);
+PinPointPoint *pp_slide_current (void);
+
+gboolean pp_color_from_string (PPColor    *color,
+                               const char *string);
+
 void
 pp_get_padding (float  stage_width,
                 float  stage_height,
@@ -137,6 +174,20 @@ pp_get_padding (float  stage_width,
 void pp_rehearse_init (void);
 void pp_rehearse_done (void);
 
+/* Slide timings, relative to the current slide: slides up to and including
+ * the current one use their rehearsed duration, the following ones their
+ * planned duration. The queries are O(1), pp_timing_update() has to be
+ * called whenever durations change other than through
+ * pp_slide_set_new_duration().
+ */
+void   pp_timing_update          (void);
+void   pp_slide_set_new_duration (gint   slideno,
+                                  gfloat new_duration);
+gfloat pp_timing_slide           (gint   slideno);
+gfloat pp_timing_start           (gint   slideno);
+gfloat pp_timing_remaining       (gint   slideno);
+gfloat pp_timing_total           (void);
+
 void
 pp_get_background_position_scale (PinPointPoint *point,
                                   float          stage_width,
@@ -148,6 +199,15 @@ pp_get_background_position_scale (PinPointPoint *point,
                                   float         *bg_scale_x,
                                   float         *bg_scale_y);
 
+void
+pp_get_background_decode_size (PinPointPoint *point,
+                               float          stage_width,
+                               float          stage_height,
+                               int            bg_width,
+                               int            bg_height,
+                               int           *decode_width,
+                               int           *decode_height);
+
 void
 pp_get_text_position_scale (PinPointPoint *point,
                             float          stage_width,
@@ -29,12 +29,17 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <pango/pango.h>
 #include <pango/pangocairo.h>
+#include <glib/gstdio.h>
 #ifdef HAVE_RSVG
 #include <librsvg/rsvg.h>
 #include <librsvg/rsvg-cairo.h>
 #endif
+#ifdef USE_CLUTTER_GST
+#include <gst/gst.h>
+#endif
 
 #include "gst-video-thumbnailer.h"
+#include "pp-pixels.h"
 
 #define CAIRO_RENDERER(renderer)  ((CairoRenderer *) renderer)
 
@@ -45,17 +50,53 @@ typedef struct _CairoRenderer
   GHashTable      *surfaces;    /* keep cairo_surface_t around for source
                                    images as we want to only include one
                                    instance of the image when using it in
-                                   several slides */
+                                   several slides, content key ->
+                                   cairo_surface_t */
+  GHashTable      *content_keys; /* file -> checksum of its contents, the
+                                   same image is only decoded and embedded
+                                   once whatever name it is used under */
   GHashTable      *svgs;        /* keep RsvgHandles around for source
                                    svg backgrounds as we want to only
                                    include one instance of the image
                                    when using it in several slides */
+  GMutex           cache_lock;  /* pages are rendered from several threads,
+                                   guards surfaces, content_keys and svgs */
+  GMutex           svg_lock;    /* RsvgHandles can only render in one
+                                   thread at a time */
+  GHashTable      *uses;        /* content key -> GArray of the indices of
+                                   the page jobs using it, in order, only
+                                   while exporting */
+  volatile gint    page;        /* index of the page job being written */
+  gint             thumbnails_pending; /* video stills being taken by
+                                   cairo_renderer_prefetch_thumbnails () */
+  gint             thumbnails_running; /* of those, the ones decoding */
+  GQueue           thumbnails_queue; /* the others, waiting their turn */
+  GHashTable      *thumbnails_in_flight; /* keys of the stills pending */
   cairo_surface_t *surface;
   cairo_t         *ctx;
   double           width;
   double           height;
 } CairoRenderer;
 
+/* A page rendered into a recording surface by a worker thread, replayed
+ * into the PDF in order by cairo_renderer_run ()
+ */
+typedef struct
+{
+  CairoRenderer   *renderer;
+  PinPointPoint   *point;
+  gboolean         notes;      /* the speaker notes page of point */
+  cairo_surface_t *recording;
+  gboolean         done;
+  GSList          *release;    /* files this is the last page of */
+} CairoPageJob;
+
+static GMutex page_lock;
+static GCond  page_cond;
+
+/* bytes of decoded pixels in all image surfaces alive, cached or not */
+static volatile gsize surface_bytes = 0;
+
 typedef struct
 {
 } CairoPointData;
@@ -73,6 +114,9 @@ _destroy_surface (gpointer data)
 
 #define A4_MARGIN     A4_LS_WIDTH * .05
 
+/* resolution images are decoded at for print, PDF units are 1/72 inch */
+#define PDF_IMAGE_DPI 300.0
+
 static void
 cairo_renderer_init (PinPointRenderer *pp_renderer,
                      char             *pinpoint_file)
@@ -89,9 +133,35 @@ cairo_renderer_init (PinPointRenderer *pp_renderer,
   renderer->ctx = cairo_create (renderer->surface);
   renderer->surfaces = g_hash_table_new_full (g_str_hash, g_str_equal,
                                               g_free, _destroy_surface);
+  renderer->content_keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, g_free);
   renderer->svgs = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                          NULL,
+                                          g_free,
                                           g_object_unref);
+  renderer->thumbnails_in_flight = g_hash_table_new_full (g_str_hash,
+                                                          g_str_equal,
+                                                          g_free, NULL);
+}
+
+static void
+_cairo_release_bytes (void *bytes)
+{
+  g_atomic_pointer_add (&surface_bytes, - (gssize) GPOINTER_TO_SIZE (bytes));
+}
+
+/* Counts the pixels of an image surface in surface_bytes until it goes */
+static void
+_cairo_track_bytes (cairo_surface_t *surface)
+{
+  static const cairo_user_data_key_t bytes_key;
+  gsize bytes;
+
+  bytes = cairo_image_surface_get_height (surface) *
+          cairo_image_surface_get_stride (surface);
+  g_atomic_pointer_add (&surface_bytes, bytes);
+  cairo_surface_set_user_data (surface, &bytes_key,
+                               GSIZE_TO_POINTER (bytes),
+                               _cairo_release_bytes);
 }
 
 /* This function is adapted from Gtk's gdk_cairo_set_source_pixbuf() you can
@@ -112,7 +182,6 @@ _cairo_new_surface_from_pixbuf (const GdkPixbuf *pixbuf)
   cairo_format_t   format;
   cairo_surface_t *surface;
   static const     cairo_user_data_key_t key;
-  int              j;
 
   if (n_channels == 3)
     format = CAIRO_FORMAT_RGB24;
@@ -127,101 +196,307 @@ _cairo_new_surface_from_pixbuf (const GdkPixbuf *pixbuf)
 
   cairo_surface_set_user_data (surface, &key,
 			       cairo_pixels, (cairo_destroy_func_t)g_free);
+  _cairo_track_bytes (surface);
 
-  for (j = height; j; j--)
-    {
-      guchar *p = gdk_pixels;
-      guchar *q = cairo_pixels;
-
-      if (n_channels == 3)
-	      {
-          guchar *end = p + 3 * width;
+  pp_pixels_to_cairo (cairo_pixels, cairo_stride,
+                      gdk_pixels, gdk_rowstride,
+                      width, height, n_channels == 4);
 
-          while (p < end)
-            {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-              q[0] = p[2];
-              q[1] = p[1];
-              q[2] = p[0];
-#else
-              q[1] = p[0];
-              q[2] = p[1];
-              q[3] = p[2];
-#endif
-              p += 3;
-              q += 4;
-            }
-	      }
-      else
-        {
-          guchar *end = p + 4 * width;
-          guint t1,t2,t3;
+  return surface;
+}
 
-#define MULT(d,c,a,t) G_STMT_START { t = c * a + 0x7f; d = ((t >> 8) + t) >> 8; } G_STMT_END
+/* Whether cairo puts the JPEG in data into PDFs as it is, and PDF viewers
+ * show it right: baseline or progressive Huffman coded grayscale or YCbCr
+ * images. CMYK ones, often stored inverted, and the rarer codings are left
+ * to be decoded.
+ */
+static gboolean
+_cairo_jpeg_embeddable (const guchar *data,
+                        gsize         length)
+{
+  gsize pos = 2;
 
-          while (p < end)
-            {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-              MULT(q[0], p[2], p[3], t1);
-              MULT(q[1], p[1], p[3], t2);
-              MULT(q[2], p[0], p[3], t3);
-              q[3] = p[3];
-#else
-              q[0] = p[3];
-              MULT(q[1], p[0], p[3], t1);
-              MULT(q[2], p[1], p[3], t2);
-              MULT(q[3], p[2], p[3], t3);
-#endif
+  if (length < 4 || data[0] != 0xff || data[1] != 0xd8)
+    return FALSE;
 
-              p += 4;
-              q += 4;
-            }
+  while (pos + 4 <= length)
+    {
+      guchar marker;
+      gsize  size;
 
-#undef MULT
+      if (data[pos] != 0xff)
+        return FALSE;
+      marker = data[pos + 1];
+      if (marker == 0xff) /* fill byte */
+        {
+          pos++;
+          continue;
+        }
+      if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7))
+        {
+          pos += 2;
+          continue;
         }
 
-      gdk_pixels += gdk_rowstride;
-      cairo_pixels += cairo_stride;
+      size = (data[pos + 2] << 8) | data[pos + 3];
+      switch (marker)
+        {
+        case 0xc0: /* baseline */
+        case 0xc1: /* extended sequential */
+        case 0xc2: /* progressive */
+          if (pos + 10 > length)
+            return FALSE;
+          return data[pos + 9] == 1 || data[pos + 9] == 3;
+        case 0xc4: /* huffman tables */
+        case 0xc8:
+        case 0xcc: /* arithmetic coding conditioning */
+          break;
+        case 0xda: /* start of scan before any frame header */
+        case 0xd9:
+          return FALSE;
+        default:
+          if (marker >= 0xc3 && marker <= 0xcf)
+            return FALSE; /* lossless, hierarchical or arithmetic coded */
+          break;
+        }
+      pos += 2 + size;
     }
-  return surface;
+
+  return FALSE;
 }
 
+/* If we embed a JPEG, we can actually insert the coded data into the PDF in
+ * a lossless fashion (no recompression of the JPEG); this also keeps the
+ * full resolution of the original. The file is mapped rather than read.
+ * Returns FALSE for JPEGs cairo would not or should not embed as they are.
+ */
 static gboolean
-_cairo_read_file (const char     *file,
-                  unsigned char **data,
-                  unsigned int   *len)
+_cairo_attach_jpeg (cairo_surface_t *surface,
+                    const char      *file)
 {
-    FILE *fp;
+  GMappedFile *mapped;
+  GError      *error = NULL;
+
+  mapped = g_mapped_file_new (file, FALSE, &error);
+  if (mapped == NULL)
+    {
+      g_warning ("could not map file %s: %s", file, error->message);
+      g_clear_error (&error);
+      return FALSE;
+    }
 
-    fp = fopen (file, "rb");
-    if (fp == NULL)
+  if (!_cairo_jpeg_embeddable ((guchar *) g_mapped_file_get_contents (mapped),
+                               g_mapped_file_get_length (mapped)))
+    {
+      g_mapped_file_unref (mapped);
       return FALSE;
+    }
+
+  cairo_surface_set_mime_data (surface, CAIRO_MIME_TYPE_JPEG,
+                               (unsigned char *)
+                                 g_mapped_file_get_contents (mapped),
+                               g_mapped_file_get_length (mapped),
+                               (cairo_destroy_func_t) g_mapped_file_unref,
+                               mapped);
+  return TRUE;
+}
+
+/* Returns the key images are cached under, a checksum of the contents of
+ * file, or file itself if it cannot be read. Owned by the renderer.
+ */
+static const char *
+_cairo_get_content_key (CairoRenderer *renderer,
+                        const char    *file)
+{
+  GMappedFile *mapped;
+  char        *key, *existing;
+
+  g_mutex_lock (&renderer->cache_lock);
+  key = g_hash_table_lookup (renderer->content_keys, file);
+  g_mutex_unlock (&renderer->cache_lock);
+  if (key)
+    return key;
+
+  mapped = g_mapped_file_new (file, FALSE, NULL);
+  if (mapped)
+    {
+      key = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+                                   (guchar *) g_mapped_file_get_contents (mapped),
+                                   g_mapped_file_get_length (mapped));
+      g_mapped_file_unref (mapped);
+    }
+  else
+    key = g_strdup (file);
+
+  g_mutex_lock (&renderer->cache_lock);
+  existing = g_hash_table_lookup (renderer->content_keys, file);
+  if (existing)
+    {
+      g_free (key);
+      key = existing;
+    }
+  else
+    g_hash_table_insert (renderer->content_keys, g_strdup (file), key);
+  g_mutex_unlock (&renderer->cache_lock);
+
+  return key;
+}
+
+/* Tells cairo which surfaces hold the same image, so that it is embedded
+ * once even when the surface was dropped from the cache and decoded again.
+ */
+static void
+_cairo_set_unique_id (cairo_surface_t *surface,
+                      const char      *key)
+{
+#ifdef CAIRO_MIME_TYPE_UNIQUE_ID
+  char *id;
+
+  /* images decoded at another size are other images to cairo */
+  id = g_strdup_printf ("%s-%dx%d", key,
+                        cairo_image_surface_get_width (surface),
+                        cairo_image_surface_get_height (surface));
+  cairo_surface_set_mime_data (surface, CAIRO_MIME_TYPE_UNIQUE_ID,
+                               (unsigned char *) id, strlen (id),
+                               g_free, id);
+#endif
+}
 
-    fseek (fp, 0, SEEK_END);
-    *len = ftell(fp);
-    fseek (fp, 0, SEEK_SET);
-    *data = g_malloc (*len);
+/* The index of the first page job from the one being written on that uses
+ * the image cached under key, G_MAXINT if none does any more. Images no
+ * page is known to use up front count as needed right away.
+ */
+static gint
+_cairo_next_use (CairoRenderer *renderer,
+                 const char    *key)
+{
+  GArray *uses = g_hash_table_lookup (renderer->uses, key);
+  gint    page = g_atomic_int_get (&renderer->page);
+  guint   i;
+
+  if (!uses)
+    return page;
+
+  for (i = 0; i < uses->len; i++)
+    if (g_array_index (uses, gint, i) >= page)
+      return g_array_index (uses, gint, i);
+
+  return G_MAXINT;
+}
+
+/* Over the memory limit, drops the cached images whose next use is the
+ * furthest down the deck (the pages using them decode them again) until
+ * within it. Images pages being rendered still use and the one just added
+ * are kept. Called with cache_lock held.
+ */
+static void
+_cairo_cache_limit (CairoRenderer *renderer,
+                    const char    *keep)
+{
+  gsize limit = (gsize) pp_memory_limit * 1024 * 1024;
 
-    if (fread(*data, *len, 1, fp) != 1)
-	return FALSE;
+  while (g_atomic_pointer_get (&surface_bytes) > limit)
+    {
+      GHashTableIter  iter;
+      gpointer        file, surface, furthest = NULL;
+      gint            furthest_use = -1;
 
-    fclose(fp);
-    return TRUE;
+      g_hash_table_iter_init (&iter, renderer->surfaces);
+      while (g_hash_table_iter_next (&iter, &file, &surface))
+        {
+          gint use = _cairo_next_use (renderer, file);
+
+          if (use > furthest_use && !g_str_equal (file, keep) &&
+              cairo_surface_get_reference_count (surface) == 1)
+            {
+              furthest = file;
+              furthest_use = use;
+            }
+        }
+
+      if (!furthest)
+        break;
+      g_hash_table_remove (renderer->surfaces, furthest);
+    }
 }
 
+/* Returns a reference to the image in file decoded at the smallest size
+ * that covers the part of the page point shows it in.
+ */
 static cairo_surface_t *
 _cairo_get_surface (CairoRenderer *renderer,
+                    PinPointPoint *point,
                     const char    *file)
 {
   cairo_surface_t *surface;
   GdkPixbuf       *pixbuf;
+  GdkPixbufFormat *format;
   GError          *error = NULL;
+  gint             width, height;
+  gint             decode_width = 0, decode_height = 0;
+  gboolean         to_pdf, jpeg;
+  const char      *key;
 
-  surface = g_hash_table_lookup (renderer->surfaces, file);
-  if (surface)
-    return surface;
+  to_pdf = renderer->surface &&
+           cairo_surface_get_type (renderer->surface) == CAIRO_SURFACE_TYPE_PDF;
+
+  /* only reads the header */
+  format = gdk_pixbuf_get_file_info (file, &width, &height);
+  jpeg = format && g_str_equal (gdk_pixbuf_format_get_name (format), "jpeg");
+
+  if (format)
+    {
+      double scale = 1.0; /* device pixels per unit */
+
+      if (to_pdf)
+        scale = PDF_IMAGE_DPI / 72.0;
+
+      pp_get_background_decode_size (point,
+                                     renderer->width * scale,
+                                     renderer->height * scale,
+                                     width, height,
+                                     &decode_width, &decode_height);
+    }
+
+  key = _cairo_get_content_key (renderer, file);
+
+  g_mutex_lock (&renderer->cache_lock);
+  surface = g_hash_table_lookup (renderer->surfaces, key);
+  if (surface &&
+      cairo_image_surface_get_width (surface) >= decode_width &&
+      cairo_image_surface_get_height (surface) >= decode_height)
+    {
+      cairo_surface_reference (surface);
+      g_mutex_unlock (&renderer->cache_lock);
+      return surface;
+    }
+  g_mutex_unlock (&renderer->cache_lock);
+
+  /* The PDF surface embeds the JPEG data as is when it is attached, the
+   * pixels are not looked at. Hand it a surface of the size of the JPEG
+   * whose pixels are never written to, and so never committed to memory,
+   * instead of decoding. It is blank, so it is not cached where anything
+   * else could pick it up; the unique id still has the PDF embed the JPEG
+   * only once.
+   */
+  if (jpeg && to_pdf)
+    {
+      surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+      if (_cairo_attach_jpeg (surface, file))
+        {
+          _cairo_set_unique_id (surface, key);
+          return surface;
+        }
+      cairo_surface_destroy (surface);
+    }
 
-  pixbuf = gdk_pixbuf_new_from_file (file, &error);
+  if (decode_width)
+    /* the JPEG loader picks a scaled DCT for the size asked for */
+    pixbuf = gdk_pixbuf_new_from_file_at_scale (file,
+                                                decode_width, decode_height,
+                                                FALSE, &error);
+  else
+    pixbuf = gdk_pixbuf_new_from_file (file, &error);
   if (pixbuf == NULL)
     {
       if (error)
@@ -233,24 +508,390 @@ _cairo_get_surface (CairoRenderer *renderer,
     }
 
   surface = _cairo_new_surface_from_pixbuf (pixbuf);
-  g_hash_table_insert (renderer->surfaces, g_strdup (file), surface);
+  g_object_unref (pixbuf);
 
-  /* If we embed a JPEG, we can actually insert the coded data into the PDF in
-   * a lossless fashion (no recompression of the JPEG) */
-  if (g_str_has_suffix (file, ".jpg") || g_str_has_suffix (file, ".jpeg"))
-      {
-        unsigned char *data = NULL;
-        guint len = 0;
+  if (jpeg)
+    _cairo_attach_jpeg (surface, file);
 
-        _cairo_read_file (file, &data, &len);
-        cairo_surface_set_mime_data (surface, CAIRO_MIME_TYPE_JPEG,
-                                     data, len,
-                                     g_free, data);
-      }
+  _cairo_set_unique_id (surface, key);
+
+  /* another page might have decoded it meanwhile, the last one wins */
+  g_mutex_lock (&renderer->cache_lock);
+  g_hash_table_insert (renderer->surfaces, g_strdup (key),
+                       cairo_surface_reference (surface));
+  if (renderer->uses)
+    _cairo_cache_limit (renderer, key);
+  g_mutex_unlock (&renderer->cache_lock);
+
+  return surface;
+}
+
+#ifdef USE_CLUTTER_GST
+
+/* Where a thumbnail is kept on disk, named after a checksum of key */
+static char *
+_cairo_get_thumbnail_path (const char *key)
+{
+  char *name, *path;
+
+  name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  path = g_strdup_printf ("%s/pinpoint/thumbnails/%s.png",
+                          g_get_user_cache_dir (), name);
+  g_free (name);
+
+  return path;
+}
+
+/* The key stills of the video in path are cached under, NULL if it cannot
+ * be found. Stills are keyed by the size and modification time of the
+ * video, where in it they are taken and the size they are shown at, so a
+ * video is only decoded again when it changes.
+ */
+static char *
+_cairo_thumbnail_key (PinPointPoint *point,
+                      const char    *path,
+                      gint           box_width,
+                      gint           box_height)
+{
+  GFile     *file;
+  GFileInfo *info;
+  char      *key;
+
+  file = g_file_new_for_path (path);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref (file);
+  if (info == NULL)
+    return NULL;
+
+  key = g_strdup_printf ("video:%s:%" G_GOFFSET_FORMAT ":%" G_GUINT64_FORMAT
+                         ":%dx%d:%d:%g",
+                         path, g_file_info_get_size (info),
+                         g_file_info_get_attribute_uint64 (info,
+                                      G_FILE_ATTRIBUTE_TIME_MODIFIED),
+                         box_width, box_height, point->bg_scale,
+                         point->poster < 0 ? -1.0 : point->poster);
+  g_object_unref (info);
+
+  return key;
+}
+
+/* Returns a reference to the still cached under key, looking in memory
+ * first and then on disk, or NULL.
+ */
+static cairo_surface_t *
+_cairo_thumbnail_lookup (CairoRenderer *renderer,
+                         const char    *key)
+{
+  cairo_surface_t *surface;
+  char            *cache_path;
+
+  g_mutex_lock (&renderer->cache_lock);
+  surface = g_hash_table_lookup (renderer->surfaces, key);
+  if (surface)
+    cairo_surface_reference (surface);
+  g_mutex_unlock (&renderer->cache_lock);
+  if (surface)
+    return surface;
+
+  cache_path = _cairo_get_thumbnail_path (key);
+  surface = cairo_image_surface_create_from_png (cache_path);
+  g_free (cache_path);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (surface);
+      return NULL;
+    }
+  _cairo_track_bytes (surface);
+
+  g_mutex_lock (&renderer->cache_lock);
+  g_hash_table_insert (renderer->surfaces, g_strdup (key),
+                       cairo_surface_reference (surface));
+  if (renderer->uses)
+    _cairo_cache_limit (renderer, key);
+  g_mutex_unlock (&renderer->cache_lock);
+
+  return surface;
+}
+
+/* Caches a fresh still under key, unless that is NULL */
+static void
+_cairo_thumbnail_store (CairoRenderer   *renderer,
+                        const char      *key,
+                        cairo_surface_t *surface)
+{
+  _cairo_track_bytes (surface);
+
+  if (key)
+    {
+      char *cache_path = _cairo_get_thumbnail_path (key);
+      char *dir = g_path_get_dirname (cache_path);
+      char *tmp = g_strdup_printf ("%s.%u", cache_path, g_random_int ());
+
+      /* written under another name first, so that pinpoints running at the
+       * same time never see half a file */
+      if (g_mkdir_with_parents (dir, 0700) == 0 &&
+          cairo_surface_write_to_png (surface, tmp) == CAIRO_STATUS_SUCCESS)
+        g_rename (tmp, cache_path);
+      else
+        g_unlink (tmp);
+      g_free (tmp);
+      g_free (dir);
+      g_free (cache_path);
+
+      /* over the memory limit, stills are dropped like any other image,
+       * they are read back from disk when needed again */
+      g_mutex_lock (&renderer->cache_lock);
+      g_hash_table_insert (renderer->surfaces, g_strdup (key),
+                           cairo_surface_reference (surface));
+      if (renderer->uses)
+        _cairo_cache_limit (renderer, key);
+      g_mutex_unlock (&renderer->cache_lock);
+    }
+}
+
+/* What a still is scaled down to, what a slide shows of it */
+typedef struct
+{
+  PinPointPoint point;
+  gint          box_width;
+  gint          box_height;
+} CairoThumbnailSize;
+
+static void
+_cairo_thumbnail_size (gint      width,
+                       gint      height,
+                       gint     *scaled_width,
+                       gint     *scaled_height,
+                       gpointer  data)
+{
+  CairoThumbnailSize *size = data;
+
+  pp_get_background_decode_size (&size->point,
+                                 size->box_width, size->box_height,
+                                 width, height, scaled_width, scaled_height);
+}
+
+static char *
+_cairo_get_video_path (PinPointPoint *point)
+{
+  GFile *file;
+  char  *path;
+
+  file = g_file_resolve_relative_path (pp_basedir, point->bg);
+  path = g_file_get_path (file);
+  g_object_unref (file);
+
+  return path;
+}
+
+/* Where the still of the video of point is taken, in nanoseconds */
+static gint64
+_cairo_get_poster_position (PinPointPoint *point)
+{
+  if (point->poster < 0)
+    return -1;
+  return point->poster * GST_SECOND;
+}
+
+/* Returns a reference to a still of the video of point, scaled down to what
+ * the page shows of it, taking it right away if it is not cached.
+ */
+static cairo_surface_t *
+_cairo_get_video_thumbnail (CairoRenderer *renderer,
+                            PinPointPoint *point)
+{
+  cairo_surface_t    *surface = NULL;
+  GCancellable       *cancellable;
+  CairoThumbnailSize  size;
+  char               *path, *key;
+  double              scale = 1.0; /* device pixels per unit */
+  gint                box_width, box_height;
+
+  if (renderer->surface &&
+      cairo_surface_get_type (renderer->surface) == CAIRO_SURFACE_TYPE_PDF)
+    scale = PDF_IMAGE_DPI / 72.0;
+  box_width = renderer->width * scale;
+  box_height = renderer->height * scale;
+
+  path = _cairo_get_video_path (point);
+  key = _cairo_thumbnail_key (point, path, box_width, box_height);
+  if (key)
+    surface = _cairo_thumbnail_lookup (renderer, key);
+
+  if (surface == NULL)
+    {
+      size.point = *point;
+      size.box_width = box_width;
+      size.box_height = box_height;
+
+      cancellable = g_cancellable_new ();
+      surface = gst_video_thumbnailer_get_shot (path,
+                                                _cairo_get_poster_position (point),
+                                                CAIRO_FORMAT_RGB24,
+                                                _cairo_thumbnail_size, &size,
+                                                cancellable);
+      g_object_unref (cancellable);
+      if (surface)
+        _cairo_thumbnail_store (renderer, key, surface);
+    }
+
+  g_free (key);
+  g_free (path);
 
   return surface;
 }
 
+typedef struct
+{
+  CairoRenderer      *renderer;
+  char               *key;
+  char               *path;
+  gint64              position;
+  CairoThumbnailSize *size;
+  GCancellable       *cancellable;
+} CairoThumbnailJob;
+
+static void _cairo_thumbnail_start (CairoRenderer *renderer);
+
+static void
+_cairo_thumbnail_job_free (CairoThumbnailJob *job)
+{
+  g_hash_table_remove (job->renderer->thumbnails_in_flight, job->key);
+  job->renderer->thumbnails_pending--;
+
+  g_free (job->key);
+  g_free (job->path);
+  g_free (job->size);
+  if (job->cancellable)
+    g_object_unref (job->cancellable);
+  g_slice_free (CairoThumbnailJob, job);
+}
+
+static void
+_cairo_thumbnail_done (GObject      *source,
+                       GAsyncResult *result,
+                       gpointer      data)
+{
+  CairoThumbnailJob *job = data;
+  CairoRenderer     *renderer = job->renderer;
+  cairo_surface_t   *surface;
+  GError            *error = NULL;
+
+  surface = gst_video_thumbnailer_get_shot_finish (result, &error);
+  if (surface)
+    {
+      _cairo_thumbnail_store (renderer, job->key, surface);
+      cairo_surface_destroy (surface);
+    }
+  else
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+      g_clear_error (&error);
+    }
+
+  renderer->thumbnails_running--;
+  _cairo_thumbnail_job_free (job);
+  _cairo_thumbnail_start (renderer);
+}
+
+/* Every still is taken by a playbin of its own, only run as many at a time
+ * as there are cores.
+ */
+static void
+_cairo_thumbnail_start (CairoRenderer *renderer)
+{
+  CairoThumbnailJob *job;
+
+  while (renderer->thumbnails_running < (gint) g_get_num_processors () &&
+         (job = g_queue_pop_head (&renderer->thumbnails_queue)))
+    {
+      if (g_cancellable_is_cancelled (job->cancellable))
+        {
+          _cairo_thumbnail_job_free (job);
+          continue;
+        }
+
+      /* the size data is now the thumbnailer's to free */
+      renderer->thumbnails_running++;
+      gst_video_thumbnailer_get_shot_async (job->path, job->position,
+                                            CAIRO_FORMAT_RGB24,
+                                            _cairo_thumbnail_size,
+                                            job->size, g_free,
+                                            job->cancellable,
+                                            _cairo_thumbnail_done,
+                                            job);
+      job->size = NULL;
+    }
+}
+
+/* Takes the stills of all the video slides that are not cached or being
+ * taken yet for pages of width by height device pixels, a few at a time
+ * and without blocking. They are cached as they come in, in the thread
+ * default main context of the caller.
+ */
+void
+cairo_renderer_prefetch_thumbnails (PinPointRenderer *pp_renderer,
+                                    gint              width,
+                                    gint              height,
+                                    GCancellable     *cancellable)
+{
+  CairoRenderer *renderer = CAIRO_RENDERER (pp_renderer);
+  guint          i;
+
+  for (i = 0; i < pp_slide_count (); i++)
+    {
+      PinPointPoint     *point = pp_slide_nth (i);
+      CairoThumbnailJob *job;
+      cairo_surface_t   *surface;
+      char              *path, *key;
+
+      if (point->bg_type != PP_BG_VIDEO)
+        continue;
+
+      path = _cairo_get_video_path (point);
+      key = _cairo_thumbnail_key (point, path, width, height);
+      if (key &&
+          !g_hash_table_contains (renderer->thumbnails_in_flight, key))
+        {
+          surface = _cairo_thumbnail_lookup (renderer, key);
+          if (surface)
+            cairo_surface_destroy (surface);
+          else
+            {
+              g_hash_table_add (renderer->thumbnails_in_flight,
+                                g_strdup (key));
+
+              job = g_slice_new (CairoThumbnailJob);
+              job->renderer = renderer;
+              job->key = key;
+              job->path = path;
+              job->position = _cairo_get_poster_position (point);
+              job->size = g_new (CairoThumbnailSize, 1);
+              job->size->point = *point;
+              job->size->box_width = width;
+              job->size->box_height = height;
+              job->cancellable = cancellable ? g_object_ref (cancellable)
+                                             : NULL;
+
+              renderer->thumbnails_pending++;
+              g_queue_push_tail (&renderer->thumbnails_queue, job);
+              key = NULL;
+              path = NULL;
+            }
+        }
+      g_free (key);
+      g_free (path);
+    }
+
+  _cairo_thumbnail_start (renderer);
+}
+
+#endif /* USE_CLUTTER_GST */
+
 #ifdef HAVE_RSVG
 
 static RsvgHandle *
@@ -260,9 +901,13 @@ _cairo_get_svg (CairoRenderer *renderer,
   RsvgHandle *svg;
   GError     *error = NULL;
 
+  g_mutex_lock (&renderer->cache_lock);
   svg = g_hash_table_lookup (renderer->svgs, file);
   if (svg)
-    return svg;
+    {
+      g_mutex_unlock (&renderer->cache_lock);
+      return svg;
+    }
 
   svg = rsvg_handle_new_from_file (file, &error);
 
@@ -273,63 +918,69 @@ _cairo_get_svg (CairoRenderer *renderer,
           g_warning ("could not load file %s: %s", file, error->message);
           g_clear_error (&error);
         }
+      g_mutex_unlock (&renderer->cache_lock);
       return NULL;
     }
 
-  g_hash_table_insert (renderer->svgs, (char *) file, svg);
+  g_hash_table_insert (renderer->svgs, g_strdup (file), svg);
+  g_mutex_unlock (&renderer->cache_lock);
 
   return svg;
 }
 
 #endif /* HAVE_RSVG */
 
+/* The file the background of point is loaded from, relative paths are
+ * relative to the presentation.
+ */
+static char *
+_cairo_get_bg_path (CairoRenderer *renderer,
+                    PinPointPoint *point)
+{
+  char *dir, *full_path;
+
+  if (point->bg_type == PP_BG_COLOR || !renderer->path)
+    return g_strdup (point->bg);
+
+  dir = g_path_get_dirname (renderer->path);
+  full_path = g_build_filename (dir, point->bg, NULL);
+  g_free (dir);
+
+  return full_path;
+}
+
 static void
 _cairo_render_background (CairoRenderer *renderer,
+                          cairo_t       *cr,
                           PinPointPoint *point)
 {
-  char       *full_path = NULL;
-  const char *file;
+  char *file;
 
   if (point == NULL || point->bg == NULL)
     return;
 
-  file = point->bg;
-
-  if (point->bg_type != PP_BG_COLOR && renderer->path && file)
-    {
-      char *dir = g_path_get_dirname (renderer->path);
-      full_path = g_build_filename (dir, file, NULL);
-      g_free (dir);
-
-      file = full_path;
-    }
+  file = _cairo_get_bg_path (renderer, point);
 
   if (point->stage_color)
     {
-      ClutterColor color;
-
-      clutter_color_from_string (&color, point->stage_color);
-      cairo_set_source_rgba (renderer->ctx,
-                             color.red / 255.f,
-                             color.green / 255.f,
-                             color.blue / 255.f,
-                             color.alpha / 255.f);
-      cairo_paint (renderer->ctx);
+      PPColor color;
+
+      pp_color_from_string (&color, point->stage_color);
+      cairo_set_source_rgba (cr,
+                             color.red, color.green, color.blue, color.alpha);
+      cairo_paint (cr);
     }
 
   switch (point->bg_type)
     {
     case PP_BG_COLOR:
       {
-        ClutterColor color;
-
-        clutter_color_from_string (&color, point->bg);
-        cairo_set_source_rgba (renderer->ctx,
-                               color.red / 255.f,
-                               color.green / 255.f,
-                               color.blue / 255.f,
-                               color.alpha / 255.f);
-        cairo_paint (renderer->ctx);
+        PPColor color;
+
+        pp_color_from_string (&color, point->bg);
+        cairo_set_source_rgba (cr,
+                               color.red, color.green, color.blue, color.alpha);
+        cairo_paint (cr);
       }
       break;
     case PP_BG_IMAGE:
@@ -337,7 +988,7 @@ _cairo_render_background (CairoRenderer *renderer,
         cairo_surface_t *surface;
         float bg_x, bg_y, bg_width, bg_height, bg_scale_x, bg_scale_y;
 
-        surface = _cairo_get_surface (renderer, file);
+        surface = _cairo_get_surface (renderer, point, file);
         if (surface == NULL)
           break;
 
@@ -351,39 +1002,28 @@ _cairo_render_background (CairoRenderer *renderer,
                                           &bg_x, &bg_y,
                                           &bg_scale_x, &bg_scale_y);
 
-        cairo_save (renderer->ctx);
-        cairo_translate (renderer->ctx, bg_x, bg_y);
-        cairo_scale (renderer->ctx, bg_scale_x, bg_scale_y);
-        cairo_set_source_surface (renderer->ctx, surface, 0., 0.);
-        cairo_paint (renderer->ctx);
-        cairo_restore (renderer->ctx);
+        cairo_save (cr);
+        cairo_translate (cr, bg_x, bg_y);
+        cairo_scale (cr, bg_scale_x, bg_scale_y);
+        cairo_set_source_surface (cr, surface, 0., 0.);
+        cairo_paint (cr);
+        cairo_restore (cr);
+        cairo_surface_destroy (surface);
       }
       break;
     case PP_BG_VIDEO:
       {
 #ifdef USE_CLUTTER_GST
-        GdkPixbuf       *pixbuf;
         cairo_surface_t *surface;
         float bg_x, bg_y, bg_width, bg_height, bg_scale_x, bg_scale_y;
-        GCancellable* cancellable = g_cancellable_new ();
-        GFile *abs_file;
-        gchar *abs_path;
-
-        abs_file = g_file_resolve_relative_path (pp_basedir, point->bg);
-        abs_path = g_file_get_path (abs_file);
-        g_object_unref (abs_file);
 
-        pixbuf = gst_video_thumbnailer_get_shot (abs_path, cancellable);
-        g_free (abs_path);
-        if (pixbuf == NULL)
+        surface = _cairo_get_video_thumbnail (renderer, point);
+        if (surface == NULL)
           {
             g_warning ("Could not create video thumbmail for %s", point->bg);
             break;
           }
 
-        surface = _cairo_new_surface_from_pixbuf (pixbuf);
-        g_hash_table_insert (renderer->surfaces, g_strdup (file), surface);
-
         bg_width = cairo_image_surface_get_width (surface);
         bg_height = cairo_image_surface_get_height (surface);
 
@@ -393,12 +1033,13 @@ _cairo_render_background (CairoRenderer *renderer,
                                           &bg_x, &bg_y,
                                           &bg_scale_x, &bg_scale_y);
 
-        cairo_save (renderer->ctx);
-        cairo_translate (renderer->ctx, bg_x, bg_y);
-        cairo_scale (renderer->ctx, bg_scale_x, bg_scale_y);
-        cairo_set_source_surface (renderer->ctx, surface, 0., 0.);
-        cairo_paint (renderer->ctx);
-        cairo_restore (renderer->ctx);
+        cairo_save (cr);
+        cairo_translate (cr, bg_x, bg_y);
+        cairo_scale (cr, bg_scale_x, bg_scale_y);
+        cairo_set_source_surface (cr, surface, 0., 0.);
+        cairo_paint (cr);
+        cairo_restore (cr);
+        cairo_surface_destroy (surface);
 #endif
         break;
       }
@@ -420,12 +1061,14 @@ _cairo_render_background (CairoRenderer *renderer,
                                           &bg_x, &bg_y,
                                           &bg_scale_x, &bg_scale_y);
 
-        cairo_save (renderer->ctx);
-        cairo_translate (renderer->ctx, bg_x, bg_y);
-        cairo_scale (renderer->ctx, bg_scale_x, bg_scale_y);
-        rsvg_handle_render_cairo (svg, renderer->ctx);
+        cairo_save (cr);
+        cairo_translate (cr, bg_x, bg_y);
+        cairo_scale (cr, bg_scale_x, bg_scale_y);
+        g_mutex_lock (&renderer->svg_lock);
+        rsvg_handle_render_cairo (svg, cr);
+        g_mutex_unlock (&renderer->svg_lock);
 
-        cairo_restore (renderer->ctx);
+        cairo_restore (cr);
       }
 #endif
       break;
@@ -436,17 +1079,18 @@ _cairo_render_background (CairoRenderer *renderer,
       g_assert_not_reached();
     }
 
-  g_free (full_path);
+  g_free (file);
 }
 
 static void
 _cairo_render_text (CairoRenderer *renderer,
+                    cairo_t       *cr,
                     PinPointPoint *point)
 {
   PangoLayout          *layout;
   PangoFontDescription *desc;
   PangoRectangle        logical_rect = { 0, };
-  ClutterColor          text_color,
+  PPColor               text_color,
                         shading_color;
 
   float text_x,    text_y,    text_width,    text_height,   text_scale;
@@ -454,7 +1098,7 @@ _cairo_render_text (CairoRenderer *renderer,
   if (point == NULL)
     return;
 
-  layout = pango_cairo_create_layout (renderer->ctx);
+  layout = pango_cairo_create_layout (cr);
   desc = pango_font_description_from_string (point->font);
   pango_layout_set_font_description (layout, desc);
   if (point->use_markup)
@@ -482,28 +1126,28 @@ _cairo_render_text (CairoRenderer *renderer,
                                 &shading_x, &shading_y,
                                 &shading_width, &shading_height);
 
-  clutter_color_from_string (&text_color, point->text_color);
-  clutter_color_from_string (&shading_color, point->shading_color);
+  pp_color_from_string (&text_color, point->text_color);
+  pp_color_from_string (&shading_color, point->shading_color);
 
-  cairo_set_source_rgba (renderer->ctx,
-                         shading_color.red / 255.f,
-                         shading_color.green / 255.f,
-                         shading_color.blue / 255.f,
-                         shading_color.alpha / 255.f * point->shading_opacity);
-  cairo_rectangle (renderer->ctx,
+  cairo_set_source_rgba (cr,
+                         shading_color.red,
+                         shading_color.green,
+                         shading_color.blue,
+                         shading_color.alpha * point->shading_opacity);
+  cairo_rectangle (cr,
                    shading_x, shading_y, shading_width, shading_height);
-  cairo_fill (renderer->ctx);
-
-  cairo_save (renderer->ctx);
-  cairo_translate (renderer->ctx, text_x, text_y);
-  cairo_scale (renderer->ctx, text_scale, text_scale);
-  cairo_set_source_rgba (renderer->ctx,
-                         text_color.red / 255.f,
-                         text_color.green / 255.f,
-                         text_color.blue / 255.f,
-                         text_color.alpha / 255.f);
-  pango_cairo_show_layout (renderer->ctx, layout);
-  cairo_restore (renderer->ctx);
+  cairo_fill (cr);
+
+  cairo_save (cr);
+  cairo_translate (cr, text_x, text_y);
+  cairo_scale (cr, text_scale, text_scale);
+  cairo_set_source_rgba (cr,
+                         text_color.red,
+                         text_color.green,
+                         text_color.blue,
+                         text_color.alpha);
+  pango_cairo_show_layout (cr, layout);
+  cairo_restore (cr);
 
 out:
   pango_font_description_free (desc);
@@ -514,13 +1158,14 @@ void
 cairo_renderer_render_page (CairoRenderer *renderer,
                             PinPointPoint *point)
 {
-  _cairo_render_background (renderer, point);
-  _cairo_render_text (renderer, point);
+  _cairo_render_background (renderer, renderer->ctx, point);
+  _cairo_render_text (renderer, renderer->ctx, point);
   cairo_show_page (renderer->ctx);
 }
 
 static void
 _cairo_render_notes (CairoRenderer *renderer,
+                     cairo_t       *cr,
                      PinPointPoint *point)
 {
   PangoLayout          *layout;
@@ -529,7 +1174,7 @@ _cairo_render_notes (CairoRenderer *renderer,
   if (point == NULL)
     return;
 
-  layout = pango_cairo_create_layout (renderer->ctx);
+  layout = pango_cairo_create_layout (cr);
   pango_layout_set_text (layout, point->speaker_notes, -1);
 
   desc = pango_font_description_from_string ("Sans");
@@ -537,38 +1182,188 @@ _cairo_render_notes (CairoRenderer *renderer,
 
   pango_layout_set_alignment (layout, PANGO_ALIGN_LEFT);
 
-  cairo_save (renderer->ctx);
-  cairo_translate (renderer->ctx, A4_MARGIN, A4_MARGIN);
-  cairo_set_source_rgba (renderer->ctx, 0., 0., 0., 1);
-  pango_cairo_show_layout (renderer->ctx, layout);
-  cairo_restore (renderer->ctx);
+  cairo_save (cr);
+  cairo_translate (cr, A4_MARGIN, A4_MARGIN);
+  cairo_set_source_rgba (cr, 0., 0., 0., 1);
+  pango_cairo_show_layout (cr, layout);
+  cairo_restore (cr);
 
   pango_font_description_free (desc);
   g_object_unref (layout);
 }
 
 static void
-cairo_render_speaker_notes (CairoRenderer *renderer,
-                            PinPointPoint *point)
+_cairo_render_job (gpointer data,
+                   gpointer user_data)
 {
-  _cairo_render_notes (renderer, point);
-  cairo_show_page (renderer->ctx);
+  CairoPageJob      *job = data;
+  cairo_rectangle_t  extents = { 0, 0,
+                                 job->renderer->width, job->renderer->height };
+  cairo_surface_t   *recording;
+  cairo_t           *cr;
+
+  recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA,
+                                              &extents);
+  cr = cairo_create (recording);
+  if (job->notes)
+    _cairo_render_notes (job->renderer, cr, job->point);
+  else
+    {
+      _cairo_render_background (job->renderer, cr, job->point);
+      _cairo_render_text (job->renderer, cr, job->point);
+    }
+  cairo_destroy (cr);
+
+  g_mutex_lock (&page_lock);
+  job->recording = recording;
+  job->done = TRUE;
+  g_cond_broadcast (&page_cond);
+  g_mutex_unlock (&page_lock);
+}
+
+/* Pages, and their speaker notes pages, are rendered into recording
+ * surfaces by a thread per core and replayed into the PDF in order. At most
+ * PAGES_IN_FLIGHT recordings are kept around per thread.
+ */
+#define PAGES_IN_FLIGHT 2
+
+/* Records that page job uses the image cached under key */
+static void
+_cairo_add_use (CairoRenderer *renderer,
+                const char    *key,
+                gint           job)
+{
+  GArray *list;
+
+  list = g_hash_table_lookup (renderer->uses, key);
+  if (!list)
+    {
+      list = g_array_new (FALSE, FALSE, sizeof (gint));
+      g_hash_table_insert (renderer->uses, g_strdup (key), list);
+    }
+  g_array_append_val (list, job);
 }
 
 static void
 cairo_renderer_run (PinPointRenderer *pp_renderer)
 {
   CairoRenderer *renderer = CAIRO_RENDERER (pp_renderer);
-  GList         *cur;
-
-  for (cur = pp_slides; cur; cur = g_list_next (cur))
+  GThreadPool   *pool;
+  CairoPageJob  *jobs;
+  GHashTableIter iter;
+#ifdef USE_CLUTTER_GST
+  GMainContext  *context;
+  double         scale = PDF_IMAGE_DPI / 72.0; /* device pixels per unit */
+#endif
+  gpointer       file, uses;
+  GSList        *s;
+  guint          n_jobs = 0, n_threads, queued, i;
+
+  jobs = g_new0 (CairoPageJob, pp_slide_count () * 2);
+  renderer->uses = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) g_array_unref);
+  renderer->page = 0;
+  for (i = 0; i < pp_slide_count (); i++)
     {
-      PinPointPoint *point = cur->data;
+      PinPointPoint *point = pp_slide_nth (i);
 
-      cairo_renderer_render_page (renderer, point);
+      if (point->bg_type == PP_BG_IMAGE)
+        {
+          char *path = _cairo_get_bg_path (renderer, point);
+
+          _cairo_add_use (renderer, _cairo_get_content_key (renderer, path),
+                          n_jobs);
+          g_free (path);
+        }
+#ifdef USE_CLUTTER_GST
+      else if (point->bg_type == PP_BG_VIDEO)
+        {
+          char *path = _cairo_get_video_path (point);
+          char *key;
+
+          /* keyed as _cairo_get_video_thumbnail () does */
+          key = _cairo_thumbnail_key (point, path,
+                                      renderer->width * scale,
+                                      renderer->height * scale);
+          if (key)
+            _cairo_add_use (renderer, key, n_jobs);
+          g_free (key);
+          g_free (path);
+        }
+#endif
+      jobs[n_jobs].renderer = renderer;
+      jobs[n_jobs++].point = point;
       if (point->speaker_notes)
-        cairo_render_speaker_notes (renderer, point);
+        {
+          jobs[n_jobs].renderer = renderer;
+          jobs[n_jobs].point = point;
+          jobs[n_jobs++].notes = TRUE;
+        }
     }
+
+  /* images and video stills are released from the cache once the last
+   * page using them has been written */
+  g_hash_table_iter_init (&iter, renderer->uses);
+  while (g_hash_table_iter_next (&iter, &file, &uses))
+    {
+      gint last = g_array_index ((GArray *) uses, gint,
+                                 ((GArray *) uses)->len - 1);
+
+      jobs[last].release = g_slist_prepend (jobs[last].release, file);
+    }
+
+#ifdef USE_CLUTTER_GST
+  /* take the stills of all videos at once up front, pages with videos
+   * would otherwise each hold up a rendering thread for it */
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+  cairo_renderer_prefetch_thumbnails (pp_renderer,
+                                      renderer->width * scale,
+                                      renderer->height * scale,
+                                      NULL);
+  while (renderer->thumbnails_pending)
+    g_main_context_iteration (context, TRUE);
+  g_main_context_pop_thread_default (context);
+  g_main_context_unref (context);
+#endif
+
+  n_threads = g_get_num_processors ();
+  pool = g_thread_pool_new (_cairo_render_job, NULL, n_threads, FALSE, NULL);
+
+  for (queued = 0, i = 0; i < n_jobs; i++)
+    {
+      /* only render ahead while within the memory limit */
+      for (; queued < n_jobs &&
+             (queued <= i ||
+              (queued < i + n_threads * PAGES_IN_FLIGHT &&
+               g_atomic_pointer_get (&surface_bytes) <
+                 (gsize) pp_memory_limit * 1024 * 1024));
+           queued++)
+        g_thread_pool_push (pool, &jobs[queued], NULL);
+
+      g_atomic_int_set (&renderer->page, i);
+
+      g_mutex_lock (&page_lock);
+      while (!jobs[i].done)
+        g_cond_wait (&page_cond, &page_lock);
+      g_mutex_unlock (&page_lock);
+
+      cairo_set_source_surface (renderer->ctx, jobs[i].recording, 0., 0.);
+      cairo_paint (renderer->ctx);
+      cairo_show_page (renderer->ctx);
+      cairo_surface_destroy (jobs[i].recording);
+
+      g_mutex_lock (&renderer->cache_lock);
+      for (s = jobs[i].release; s; s = s->next)
+        g_hash_table_remove (renderer->surfaces, s->data);
+      g_mutex_unlock (&renderer->cache_lock);
+      g_slist_free (jobs[i].release);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_hash_table_unref (renderer->uses);
+  renderer->uses = NULL;
+  g_free (jobs);
 }
 
 static void
@@ -580,7 +1375,14 @@ cairo_renderer_finalize (PinPointRenderer *pp_renderer)
   if (renderer->surface)
     cairo_surface_destroy (renderer->surface);
   g_hash_table_unref (renderer->surfaces);
+  g_hash_table_unref (renderer->content_keys);
   g_hash_table_unref (renderer->svgs);
+#ifdef USE_CLUTTER_GST
+  g_queue_foreach (&renderer->thumbnails_queue,
+                   (GFunc) _cairo_thumbnail_job_free, NULL);
+  g_queue_clear (&renderer->thumbnails_queue);
+#endif
+  g_hash_table_unref (renderer->thumbnails_in_flight);
   if (renderer->ctx)
     cairo_destroy (renderer->ctx);
 }
@@ -594,9 +1396,9 @@ cairo_renderer_make_point (PinPointRenderer *pp_renderer,
 
   if (point->bg_type == PP_BG_COLOR)
     {
-      ClutterColor color;
+      PPColor color;
 
-      ret = clutter_color_from_string (&color, point->bg); /* this roughly checks that the color is valid? */
+      ret = pp_color_from_string (&color, point->bg); /* this roughly checks that the color is valid? */
     }
 
   return ret;
@@ -31,6 +31,7 @@
 #include <clutter/x11/clutter-x11.h>
 #endif
 #include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
 #ifdef USE_CLUTTER_GST
 #include <clutter-gst/clutter-gst.h>
 #endif
@@ -51,6 +52,11 @@ void cairo_renderer_set_cr (PinPointRenderer *pp_renderer,
 void cairo_renderer_render_page (void          *renderer,
                                  PinPointPoint *point);
 
+void cairo_renderer_prefetch_thumbnails (PinPointRenderer *pp_renderer,
+                                         gint              width,
+                                         gint              height,
+                                         GCancellable     *cancellable);
+
 /* #define QUICK_ACCESS_LEFT - uncomment to move speed access from top to left,
  *                             useful on meego netbook
  */
@@ -68,6 +74,17 @@ void cairo_renderer_render_page (void          *renderer,
 #define OPACITY_PAST_THRESHOLD   96
 #define OPACITY_OVER_TIME        140
 
+/* Parts of the speaker screen waiting to be brought up to date */
+#define SPEAKER_DIRTY_SLIDE      (1 << 0) /* notes, previews, slide progress */
+#define SPEAKER_DIRTY_TIME       (1 << 1) /* countdown and time progress */
+#define SPEAKER_DIRTY_LAYOUT     (1 << 2) /* positions and sizes */
+#define SPEAKER_DIRTY_ALL        (SPEAKER_DIRTY_SLIDE | SPEAKER_DIRTY_TIME | \
+                                  SPEAKER_DIRTY_LAYOUT)
+
+#define ASSET_THREADS  2
+#define ASSET_BUDGET   (256 * 1024 * 1024) /* bytes of decoded backgrounds
+                                              to keep around */
+
 #define PREVIEW_WIDTH  640
 #define PREVIEW_HEIGHT 480
 
@@ -92,7 +109,13 @@ typedef enum _PPClutterBackend
 typedef struct _ClutterRenderer
 {
   PinPointRenderer renderer;
-  GHashTable      *bg_cache;    /* only load the same backgrounds once */
+  GHashTable      *bg_cache;    /* only load the same backgrounds once,
+                                   file name -> PPAsset */
+  GThreadPool     *asset_pool;  /* decodes the PPAssets */
+  GHashTable      *transitions; /* name -> PPTransition, read only once */
+  GSList          *transition_preload; /* names left to read at startup */
+  guint            transition_preload_idle;
+  gsize            asset_bytes; /* size of the loaded PPAssets */
   ClutterActor    *stage;
   ClutterActor    *root;
 
@@ -141,11 +164,26 @@ typedef struct _ClutterRenderer
   char *path;               /* path of the file of the GFileMonitor callback */
   float rest_y;             /* where the text can rest */
 
-  gboolean reset;           /* tells the speaker screen update function to
-                               reset all state
-                             */
-
-  PinPointRenderer *cairo_renderer;
+  PinPointPoint   *speaker_slide;          /* slide the timing below is for */
+  gdouble          speaker_slide_start;    /* timer value when it was shown */
+  float            speaker_slide_duration; /* time budgeted for it */
+  gint             speaker_warning;        /* opacity of the time warning */
+  guint            speaker_deadline;       /* fires at the next warning or
+                                              autoadvance change */
+  guint            speaker_tick;           /* countdown updates */
+  guint            speaker_dirty;          /* SPEAKER_DIRTY_* flags */
+  guint            speaker_update;         /* idle applying speaker_dirty */
+  PinPointPoint   *speaker_previews;       /* slide the previews are for */
+
+  PinPointRenderer *cairo_renderer; /* only used from the preview_pool, and
+                                       to prefetch video stills */
+  GThreadPool      *preview_pool;   /* renders speaker screen previews */
+  GCancellable     *thumbnails;     /* video stills for the previews */
+
+  GList            *videos_live;    /* ClutterPointData of the slides with a
+                                       running video decoder */
+  GSList           *video_pool;     /* video textures to reuse */
+  GHashTable       *cameras;        /* key -> PPCamera */
 
   /* Proxy object for the Gnome Session Manager; used to inhibit suspend during
    * presentations.
@@ -159,26 +197,124 @@ typedef struct _ClutterRenderer
   PPClutterBackend  clutter_backend;
 } ClutterRenderer;
 
+typedef struct _PreviewJob PreviewJob;
+
+/* The template of a transition */
+typedef struct
+{
+  char  *json;    /* contents of the .json file, NULL if not found */
+  gsize  length;
+  char  *dir;     /* where it was found, for paths relative to it */
+  GList *idle;    /* PPTransitionInstances not bound to a slide */
+} PPTransition;
+
+/* The actors of a transition; bound to a slide from when it is shown until
+ * its leaving transition completes. There are only as many as there are
+ * slides transitioning at the same time.
+ */
+typedef struct
+{
+  ClutterRenderer *renderer;
+  PPTransition    *transition;  /* the template */
+  PinPointPoint   *point;       /* bound slide, NULL when idle */
+  ClutterScript   *script;
+  ClutterState    *state;
+  ClutterActor    *json_slide;
+  ClutterActor    *background2;
+  ClutterActor    *midground;
+  ClutterActor    *foreground;
+  ClutterActor    *shading;
+} PPTransitionInstance;
+
+typedef enum
+{
+  ASSET_EMPTY,
+  ASSET_LOADING,
+  ASSET_LOADED,
+  ASSET_FAILED
+} PPAssetState;
+
+/* A background image, shared by the slides using it. It is decoded in the
+ * asset_pool when a slide using it comes close.
+ */
+typedef struct
+{
+  ClutterRenderer *renderer;
+  char            *file;
+  ClutterActor    *texture;   /* hidden, the slides show clones of it */
+  PPAssetState     state;
+  gint             width;     /* size of the image, once known */
+  gint             height;
+  gint             decoded_width;  /* size it was decoded at */
+  gint             decoded_height;
+  gsize            bytes;     /* memory used by the texture when loaded */
+  gint             next_use;  /* slides until it is needed, for eviction */
+} PPAsset;
+
+#ifdef USE_CLUTTER_GST
+/* A camera in a given mode, shared by the slides showing it. Its device is
+ * only opened while the current or the next slide shows it, and in one mode
+ * at a time.
+ */
+typedef struct
+{
+  ClutterRenderer *renderer;
+  char            *key;        /* device, resolution and framerate */
+  char            *device;     /* NULL for the default one */
+  PPResolution     resolution; /* 0x0: the smallest covering the stage */
+  gint             framerate;  /* 0: any */
+  ClutterActor    *texture;    /* hidden, the slides show clones of it */
+  GstElement      *pipeline;   /* NULL while closed */
+  gboolean         failed;     /* could not be opened, not retried until
+                                  it has been out of reach */
+  guint            users;      /* prepared slides showing it */
+} PPCamera;
+#endif
+
+typedef struct
+{
+  PPAsset       *asset;
+  gint           priority;    /* lower is decoded first */
+  PinPointPoint  point;       /* copy of the slide, for its scaling mode */
+  float          stage_width;
+  float          stage_height;
+  gint           width;       /* size of the image */
+  gint           height;
+  GdkPixbuf     *pixbuf;      /* the image, decoded at the size needed */
+} AssetJob;
+
 typedef struct
 {
   PinPointRenderer *renderer;
   ClutterActor     *background;
+  PPAsset          *asset;      /* the background image, if any */
   ClutterActor     *text;
   float rest_y;     /* y coordinate when text is stationary unused */
+  gboolean rest_assigned; /* rest_y is set, kept when prepared again */
 
-  ClutterState     *state;
-  ClutterActor     *json_slide;
-  ClutterActor     *background2;
-  ClutterScript    *script;
-  ClutterActor     *midground;
-  ClutterActor     *foreground;
-  ClutterActor     *shading;
+  PPTransitionInstance *transition; /* while the slide uses one */
 
 #ifdef USE_CLUTTER_GST
-  GstElement       *pipeline; /* used for the custom camera pipeline */
+  PPCamera         *camera;   /* the camera shown, if any */
+  gboolean          video_opened; /* the video texture has the file */
 #endif
+
+  cairo_surface_t  *preview;     /* speaker screen thumbnail of the slide */
+  PreviewJob       *preview_job; /* pending rendering of the thumbnail */
 } ClutterPointData;
 
+/* A thumbnail being rendered in the preview thread */
+struct _PreviewJob
+{
+  ClutterRenderer  *renderer;
+  ClutterPointData *data;       /* NULL once the slide is gone */
+  PinPointPoint     point;      /* copy of the slide for the renderer */
+  gint              width;
+  gint              height;
+  gint              cancelled;
+  cairo_surface_t  *surface;
+};
+
 #define CLUTTER_RENDERER(renderer)  ((ClutterRenderer *) renderer)
 
 
@@ -187,6 +323,30 @@ static void     leave_slide   (ClutterRenderer  *renderer,
 static void     show_slide    (ClutterRenderer  *renderer,
                                gboolean          backwards);
 static void     action_slide  (ClutterRenderer  *renderer);
+static void     speaker_invalidate     (ClutterRenderer *renderer,
+                                        guint            dirty);
+static void     speaker_timing_changed (ClutterRenderer *renderer);
+static void     preview_render         (gpointer         job_data,
+                                        gpointer         user_data);
+static void     asset_decode           (gpointer         job_data,
+                                        gpointer         user_data);
+static gint     asset_job_compare      (gconstpointer    a,
+                                        gconstpointer    b,
+                                        gpointer         user_data);
+static void     _destroy_transition    (gpointer         data);
+static PPTransition *pp_get_transition (ClutterRenderer *renderer,
+                                        const char      *name);
+static void     transition_release     (PPTransitionInstance *instance);
+static void     speaker_prefetch_thumbnails (ClutterRenderer *renderer);
+#ifdef USE_CLUTTER_GST
+static ClutterActor *video_texture_get (ClutterRenderer *renderer);
+static void     video_texture_free     (gpointer         texture);
+static void     _destroy_camera        (gpointer         data);
+static void     video_release          (ClutterRenderer  *renderer,
+                                        ClutterPointData *data);
+#endif
+static void     videos_update          (ClutterRenderer *renderer);
+static gboolean transition_preload     (gpointer         data);
 static void     activate_commandline   (ClutterRenderer  *renderer);
 static void     file_changed  (GFileMonitor     *monitor,
                                GFile            *file,
@@ -221,6 +381,9 @@ pp_clutter_render_adjust_background (ClutterRenderer *renderer,
   else
     {
       clutter_actor_get_size (data->background, &bg_width, &bg_height);
+      if (bg_width < 1 || bg_height < 1 ||
+          (data->asset && !data->asset->bytes))
+        return; /* not loaded yet */
     }
 
   pp_get_background_position_scale (point,
@@ -333,11 +496,15 @@ pp_get_fullscreen (ClutterRenderer *renderer,
 }
 
 static void
-_destroy_surface (gpointer data)
+_destroy_asset (gpointer data)
 {
-  /* not destroying background, since it would be destroyed with
+  PPAsset *asset = data;
+
+  /* not destroying the texture, since it would be destroyed with
    * the stage itself.
    */
+  g_free (asset->file);
+  g_slice_free (PPAsset, asset);
 }
 
 static guint hide_cursor = 0;
@@ -355,11 +522,10 @@ activate_commandline (ClutterRenderer *renderer)
 {
   PinPointPoint *point;
 
-  if (!pp_slidep)
+  point = pp_slide_current ();
+  if (!point)
     return;
 
-  point = pp_slidep->data;
-
   clutter_actor_animate (renderer->commandline,
                          CLUTTER_LINEAR, 500,
                          "opacity",      0xff,
@@ -384,7 +550,7 @@ static gboolean commandline_cancel_cb (ClutterActor *actor,
                                        gpointer      data)
 {
   ClutterRenderer *renderer = CLUTTER_RENDERER (data);
-  PinPointPoint *point = pp_slidep->data;
+  PinPointPoint *point = pp_slide_current ();
 
   if (clutter_event_type (event) == CLUTTER_KEY_PRESS &&
       (clutter_event_get_key_symbol (event) == CLUTTER_Escape ||
@@ -408,7 +574,7 @@ static gboolean commandline_action_cb (ClutterActor *actor,
                                        gpointer      data)
 {
   ClutterRenderer *renderer = CLUTTER_RENDERER (data);
-  PinPointPoint *point = pp_slidep->data;
+  PinPointPoint *point = pp_slide_current ();
   clutter_actor_grab_key_focus (renderer->stage);
   clutter_actor_animate (renderer->commandline,
                          CLUTTER_LINEAR, 500,
@@ -461,11 +627,11 @@ static gboolean stage_motion (ClutterActor *actor,
     {
       float d = event->motion.x / stage_width;
 #endif
-      if (pp_slidep)
+      if (pp_slide_current ())
         {
           leave_slide (renderer, FALSE);
         }
-      pp_slidep = g_list_nth (pp_slides, g_list_length (pp_slides) * d);
+      pp_slideno = MIN (pp_slide_count () * d, pp_slide_count () - 1);
       show_slide (renderer, FALSE);
     }
 
@@ -527,6 +693,7 @@ play_pause (ClutterActor *actor,
       renderer->timer_paused = TRUE;
       clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_pause), "go");
     }
+  speaker_timing_changed (renderer);
   return TRUE;
 }
 
@@ -548,6 +715,7 @@ toggle_autoadvance (ClutterActor *actor,
       clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_autoadvance),
                              "disable autoadvance");
     }
+  speaker_timing_changed (renderer);
   return TRUE;
 }
 
@@ -556,10 +724,10 @@ static void end_of_presentation (ClutterRenderer *renderer);
 static void
 next_slide (ClutterRenderer *renderer)
 {
-  if (pp_slidep && pp_slidep->next)
+  if (pp_slide_current () && pp_slide_nth (pp_slideno + 1))
     {
       leave_slide (renderer, FALSE);
-      pp_slidep = pp_slidep->next;
+      pp_slideno++;
       show_slide (renderer, FALSE);
     }
   else
@@ -571,10 +739,10 @@ next_slide (ClutterRenderer *renderer)
 static void
 prev_slide (ClutterRenderer *renderer)
 {
-  if (pp_slidep && pp_slidep->prev)
+  if (pp_slide_current () && pp_slideno > 0)
     {
       leave_slide (renderer, TRUE);
-      pp_slidep = pp_slidep->prev;
+      pp_slideno--;
       show_slide (renderer, TRUE);
     }
 }
@@ -608,8 +776,9 @@ start (ClutterActor *actor,
   g_timer_stop (renderer->timer);
   g_timer_start (renderer->timer);
   renderer->timer_paused = FALSE;
-  leave_slide (renderer, TRUE);
-  pp_slidep = pp_slides;
+  if (pp_slide_current ())
+    leave_slide (renderer, TRUE);
+  pp_slideno = pp_slide_count () ? 0 : -1;
   play_pause (NULL, NULL, data);
   play_pause (NULL, NULL, data);
   if (pp_rehearse)
@@ -617,8 +786,8 @@ start (ClutterActor *actor,
       pp_rehearse = FALSE;
     }
   pp_rehearse_init (); /* zeroes out the new-time */
+  renderer->speaker_slide = NULL; /* restart the slide timing */
   show_slide (renderer, TRUE);
-  renderer->reset = TRUE;
   return TRUE;
 }
 
@@ -770,6 +939,7 @@ clutter_renderer_init_speaker_screen (ClutterRenderer *renderer)
   renderer->timer_paused = TRUE;
   renderer->timer = g_timer_new ();
   g_timer_stop (renderer->timer);
+  renderer->speaker_slide = NULL;
 
   renderer->speaker_prog_bg = clutter_rectangle_new_with_color (&c_prog_bg);
   renderer->speaker_prog_time = clutter_rectangle_new_with_color (&c_prog_time);
@@ -805,6 +975,7 @@ clutter_renderer_init_speaker_screen (ClutterRenderer *renderer)
 
 
   clutter_actor_set_opacity (renderer->speaker_slide_prog_warning, 0);
+  renderer->speaker_warning = -1;
 
 
 
@@ -937,10 +1108,23 @@ clutter_renderer_init (PinPointRenderer   *pp_renderer,
     }
 
   renderer->bg_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                              NULL, _destroy_surface);
+                                              NULL, _destroy_asset);
+  renderer->transitions = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, _destroy_transition);
+#ifdef USE_CLUTTER_GST
+  renderer->cameras = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             NULL, _destroy_camera);
+#endif
+  renderer->asset_pool = g_thread_pool_new (asset_decode, NULL,
+                                            ASSET_THREADS, FALSE, NULL);
+  g_thread_pool_set_sort_function (renderer->asset_pool,
+                                   asset_job_compare, NULL);
 
   renderer->cairo_renderer = pp_cairo_renderer ();
   renderer->cairo_renderer->init (renderer->cairo_renderer, pinpoint_file);
+  /* a single thread, the cairo renderer keeps state across pages */
+  renderer->preview_pool = g_thread_pool_new (preview_render, NULL,
+                                              1, FALSE, NULL);
 
   session_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
   if (session_bus != NULL)
@@ -959,19 +1143,16 @@ clutter_renderer_init (PinPointRenderer   *pp_renderer,
     }
 }
 
-static gboolean update_speaker_screen (ClutterRenderer *renderer);
-
 static void
 clutter_renderer_run (PinPointRenderer *pp_renderer)
 {
   ClutterRenderer *renderer = CLUTTER_RENDERER (pp_renderer);
 
-  show_slide (renderer, FALSE);
-
   /* the presentaiton is not parsed at first initialization,.. */
   renderer->total_seconds = point_defaults->duration * 60;
 
-  g_timeout_add (15, (GSourceFunc)update_speaker_screen, renderer);
+  speaker_prefetch_thumbnails (renderer);
+  show_slide (renderer, FALSE);
   clutter_main ();
 }
 
@@ -980,37 +1161,327 @@ clutter_renderer_finalize (PinPointRenderer *pp_renderer)
 {
   ClutterRenderer *renderer = CLUTTER_RENDERER (pp_renderer);
 
+  if (renderer->speaker_deadline)
+    g_source_remove (renderer->speaker_deadline);
+  if (renderer->speaker_tick)
+    g_source_remove (renderer->speaker_tick);
+  if (renderer->speaker_update)
+    g_source_remove (renderer->speaker_update);
+  if (renderer->transition_preload_idle)
+    g_source_remove (renderer->transition_preload_idle);
+  g_slist_free (renderer->transition_preload);
+
+  if (renderer->thumbnails)
+    {
+      g_cancellable_cancel (renderer->thumbnails);
+      g_object_unref (renderer->thumbnails);
+    }
+  g_thread_pool_free (renderer->preview_pool, TRUE, TRUE);
+  g_thread_pool_free (renderer->asset_pool, TRUE, TRUE);
+
+  g_list_free (renderer->videos_live);
+#ifdef USE_CLUTTER_GST
+  g_slist_free_full (renderer->video_pool, video_texture_free);
+  g_hash_table_unref (renderer->cameras);
+#endif
+
   clutter_actor_destroy (renderer->stage);
   g_hash_table_unref (renderer->bg_cache);
+  g_hash_table_unref (renderer->transitions);
   g_clear_object (&renderer->gsm);
 }
 
-static ClutterActor *
-_clutter_get_texture (ClutterRenderer *renderer,
-                      const char      *file)
+static PPAsset *
+_clutter_get_asset (ClutterRenderer *renderer,
+                    const char      *file)
+{
+  PPAsset *asset;
+
+  asset = g_hash_table_lookup (renderer->bg_cache, file);
+  if (asset)
+    return asset;
+
+  asset = g_slice_new0 (PPAsset);
+  asset->renderer = renderer;
+  asset->file = g_strdup (file);
+  /* the pixels are filled in by asset_request () */
+  asset->texture = clutter_texture_new ();
+
+  clutter_container_add_actor (CLUTTER_CONTAINER (renderer->stage),
+                               asset->texture);
+  clutter_actor_hide (asset->texture);
+
+  g_hash_table_insert (renderer->bg_cache, asset->file, asset);
+
+  return asset;
+}
+
+/* The background file of point, relative to the presentation */
+static char *
+_clutter_get_bg_path (ClutterRenderer *renderer,
+                      PinPointPoint   *point)
+{
+  char *dir;
+  char *path;
+
+  if (point->bg_type == PP_BG_COLOR || !renderer->path || !point->bg)
+    return g_strdup (point->bg);
+
+  dir = g_path_get_dirname (renderer->path);
+  path = g_build_filename (dir, point->bg, NULL);
+  g_free (dir);
+
+  return path;
+}
+
+/* Finds the loaded asset whose next use is furthest away, which is the one
+ * an optimal cache drops first; the slide order tells us the future. Returns
+ * NULL when every loaded asset is needed before incoming.
+ */
+static PPAsset *
+asset_furthest (ClutterRenderer *renderer,
+                PPAsset         *incoming)
 {
-  ClutterActor *source;
+  GHashTableIter iter;
+  PPAsset       *asset;
+  PPAsset       *victim = NULL;
+  gint           i;
+
+  g_hash_table_iter_init (&iter, renderer->bg_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &asset))
+    asset->next_use = G_MAXINT;
 
-  source = g_hash_table_lookup (renderer->bg_cache, file);
-  if (source)
+  /* stepping back a slide is as likely as going forward */
+  for (i = pp_slideno - 1; i < (gint) pp_slide_count (); i++)
     {
-      return clutter_clone_new (source);
+      PinPointPoint    *point = pp_slide_nth (i);
+      ClutterPointData *data;
+
+      if (!point)
+        continue;
+      data = point->data;
+      if (data->asset && data->asset->next_use == G_MAXINT)
+        data->asset->next_use = ABS (i - pp_slideno);
     }
 
-  source = g_object_new (CLUTTER_TYPE_TEXTURE,
-                         "filename", file,
-                         "load-data-async", TRUE,
-                         NULL);
+  g_hash_table_iter_init (&iter, renderer->bg_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &asset))
+    {
+      if (asset->state != ASSET_LOADED || asset == incoming ||
+          asset->next_use <= incoming->next_use)
+        continue;
+      if (!victim || asset->next_use > victim->next_use)
+        victim = asset;
+    }
 
-  if (!source)
-    return NULL;
+  return victim;
+}
+
+/* Drops the pixels of an asset, the prefetcher loads them again when a
+ * slide using it comes close.
+ */
+static void
+asset_evict (ClutterRenderer *renderer,
+             PPAsset         *asset)
+{
+  static const guchar empty[4] = { 0, };
+
+  clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (asset->texture),
+                                     empty, TRUE, 1, 1, 4, 4,
+                                     CLUTTER_TEXTURE_NONE, NULL);
+  renderer->asset_bytes -= asset->bytes;
+  asset->bytes = 0;
+  asset->state = ASSET_EMPTY;
+}
+
+static void
+asset_make_room (ClutterRenderer *renderer,
+                 PPAsset         *incoming,
+                 gsize            bytes)
+{
+  while (renderer->asset_bytes + bytes > ASSET_BUDGET)
+    {
+      PPAsset *victim = asset_furthest (renderer, incoming);
+
+      if (!victim)
+        break; /* everything is needed sooner, go over budget */
+      asset_evict (renderer, victim);
+    }
+}
+
+static gboolean
+asset_done (gpointer user_data)
+{
+  AssetJob        *job      = user_data;
+  PPAsset         *asset    = job->asset;
+  ClutterRenderer *renderer = asset->renderer;
+  PinPointPoint   *point;
+  GError          *error = NULL;
+
+  /* when decoding again at a bigger size the old pixels are kept until
+     the new ones arrive */
+  asset->state = asset->bytes ? ASSET_LOADED : ASSET_FAILED;
+  if (job->pixbuf)
+    {
+      gsize bytes = gdk_pixbuf_get_width (job->pixbuf) *
+                    gdk_pixbuf_get_height (job->pixbuf) * 4;
+
+      asset_make_room (renderer, asset,
+                       bytes > asset->bytes ? bytes - asset->bytes : 0);
+      if (clutter_texture_set_from_rgb_data (CLUTTER_TEXTURE (asset->texture),
+                                   gdk_pixbuf_get_pixels (job->pixbuf),
+                                   gdk_pixbuf_get_has_alpha (job->pixbuf),
+                                   gdk_pixbuf_get_width (job->pixbuf),
+                                   gdk_pixbuf_get_height (job->pixbuf),
+                                   gdk_pixbuf_get_rowstride (job->pixbuf),
+                                   gdk_pixbuf_get_n_channels (job->pixbuf),
+                                   CLUTTER_TEXTURE_NONE,
+                                   &error))
+        {
+          asset->state = ASSET_LOADED;
+          asset->width = job->width;
+          asset->height = job->height;
+          asset->decoded_width = gdk_pixbuf_get_width (job->pixbuf);
+          asset->decoded_height = gdk_pixbuf_get_height (job->pixbuf);
+          renderer->asset_bytes -= asset->bytes;
+          renderer->asset_bytes += bytes;
+          asset->bytes = bytes;
+        }
+      else
+        {
+          g_warning ("could not upload %s: %s", asset->file, error->message);
+          g_clear_error (&error);
+        }
+      g_object_unref (job->pixbuf);
+    }
+
+  /* the clone showing it now knows its size */
+  point = pp_slide_current ();
+  if (point && ((ClutterPointData *) point->data)->asset == asset)
+    pp_clutter_render_adjust_background (renderer, point);
+
+  g_slice_free (AssetJob, job);
+  return FALSE;
+}
+
+/* Runs in one of the asset_pool threads */
+static void
+asset_decode (gpointer job_data,
+              gpointer user_data)
+{
+  AssetJob *job   = job_data;
+  GError   *error = NULL;
+  gint      width, height;
+
+  if (gdk_pixbuf_get_file_info (job->asset->file, &job->width, &job->height))
+    {
+      pp_get_background_decode_size (&job->point,
+                                     job->stage_width, job->stage_height,
+                                     job->width, job->height,
+                                     &width, &height);
+      /* the JPEG loader picks a scaled DCT for the size asked for */
+      job->pixbuf = gdk_pixbuf_new_from_file_at_scale (job->asset->file,
+                                                       width, height,
+                                                       FALSE, &error);
+    }
+  else
+    {
+      job->pixbuf = gdk_pixbuf_new_from_file (job->asset->file, &error);
+      if (job->pixbuf)
+        {
+          job->width = gdk_pixbuf_get_width (job->pixbuf);
+          job->height = gdk_pixbuf_get_height (job->pixbuf);
+        }
+    }
+  if (job->pixbuf == NULL)
+    {
+      g_warning ("could not load file %s: %s", job->asset->file,
+                 error ? error->message : "unknown error");
+      g_clear_error (&error);
+    }
+
+  g_idle_add (asset_done, job);
+}
 
-  clutter_container_add_actor (CLUTTER_CONTAINER (renderer->stage), source);
-  clutter_actor_hide (source);
+static gint
+asset_job_compare (gconstpointer a,
+                   gconstpointer b,
+                   gpointer      user_data)
+{
+  const AssetJob *job_a = a;
+  const AssetJob *job_b = b;
+
+  return job_a->priority - job_b->priority;
+}
+
+static void
+asset_request (ClutterRenderer *renderer,
+               PinPointPoint   *point,
+               gint             priority)
+{
+  ClutterPointData *data;
+  AssetJob         *job;
+  float             stage_width, stage_height;
+
+  if (!point)
+    return;
+
+  data = point->data;
+  if (!data->asset)
+    return;
+
+  clutter_actor_get_size (renderer->stage, &stage_width, &stage_height);
+
+  switch (data->asset->state)
+    {
+    case ASSET_EMPTY:
+      break;
+    case ASSET_LOADED:
+      {
+        gint width, height;
+
+        /* only decode again if more pixels are needed now, like when the
+           stage grew */
+        pp_get_background_decode_size (point, stage_width, stage_height,
+                                       data->asset->width, data->asset->height,
+                                       &width, &height);
+        if (width <= data->asset->decoded_width &&
+            height <= data->asset->decoded_height)
+          return;
+      }
+      break;
+    default:
+      return;
+    }
 
-  g_hash_table_insert (renderer->bg_cache, (char *) g_strdup (file), source);
+  job = g_slice_new0 (AssetJob);
+  job->asset = data->asset;
+  job->priority = priority;
+  job->point = *point;
+  job->point.speaker_notes = NULL;
+  job->point.source = NULL;
+  job->point.data = NULL;
+  job->stage_width = stage_width;
+  job->stage_height = stage_height;
+
+  data->asset->state = ASSET_LOADING;
+  g_thread_pool_push (renderer->asset_pool, job, NULL);
+}
 
-  return clutter_clone_new (source);
+/* Makes sure the backgrounds of the current slide, the previous one and of
+ * as many upcoming ones as configured get decoded, closest ones first.
+ */
+static void
+asset_prefetch (ClutterRenderer *renderer)
+{
+  gint ahead = pp_prefetch >= 0 ? pp_prefetch : point_defaults->prefetch;
+  gint i;
+
+  asset_request (renderer, pp_slide_current (), 0);
+  asset_request (renderer, pp_slide_nth (pp_slideno + 1), 1);
+  asset_request (renderer, pp_slide_nth (pp_slideno - 1), 2);
+  for (i = 2; i <= ahead; i++)
+    asset_request (renderer, pp_slide_nth (pp_slideno + i), i + 1);
 }
 
 #if USE_CLUTTER_GST
@@ -1025,136 +1496,390 @@ on_size_changed (ClutterActor *texture,
   PinPointPoint *point;
   ClutterPointData *data;
 
-  point = pp_slidep->data;
+  point = pp_slide_current ();
   if (!point)
     return;
 
   data = point->data;
 
-  if (data->background != texture)
+  clutter_actor_set_size (texture, width, height);
+
+  if (data->background != texture &&
+      !(CLUTTER_IS_CLONE (data->background) &&
+        clutter_clone_get_source (CLUTTER_CLONE (data->background)) == texture))
+    return; /* not showing right now */
+
+  pp_clutter_render_adjust_background (renderer, point);
+}
+
+/* Returns the camera shown by point, with a user more */
+static PPCamera *
+camera_get (ClutterRenderer *renderer,
+            PinPointPoint   *point)
+{
+  const char *device = point->camera_device;
+  PPCamera   *camera;
+  char       *key;
+
+  if (!device)
+    device = pp_camera_device;
+
+  key = g_strdup_printf ("%s:%dx%d@%d", device ? device : "",
+                         point->camera_resolution.width,
+                         point->camera_resolution.height,
+                         point->camera_framerate);
+  camera = g_hash_table_lookup (renderer->cameras, key);
+  if (camera)
     {
-      g_warning ("size changed but not current background ?!");
-      return;
+      g_free (key);
+      camera->users++;
+      return camera;
     }
 
-  clutter_actor_set_size (texture, width, height);
-  pp_clutter_render_adjust_background (renderer, point);
+  camera = g_slice_new0 (PPCamera);
+  camera->renderer = renderer;
+  camera->key = key;
+  camera->device = g_strdup (device);
+  camera->resolution = point->camera_resolution;
+  camera->framerate = point->camera_framerate;
+  camera->users = 1;
+
+  camera->texture = g_object_new (CLUTTER_TYPE_TEXTURE,
+                                  "disable-slicing", TRUE,
+                                  NULL);
+  /* kept hidden on the stage, slides come and go with their clones */
+  clutter_container_add_actor (CLUTTER_CONTAINER (renderer->stage),
+                               camera->texture);
+  clutter_actor_hide (camera->texture);
+
+  g_signal_connect (CLUTTER_TEXTURE (camera->texture),
+                    "size-change",
+                    G_CALLBACK (on_size_changed), renderer);
+
+  g_hash_table_insert (renderer->cameras, camera->key, camera);
+
+  return camera;
 }
 
-static gboolean
-setup_camera (PinPointRenderer *renderer,
-              PinPointPoint    *point)
+static void
+camera_close (PPCamera *camera)
 {
-  /* These are static to be able to share the texture and the pipeline between
-   * all the slides using the camera */
-  static ClutterActor *texture = NULL;
-  static GstElement   *pipeline = NULL;
+  if (!camera->pipeline)
+    return;
 
-  ClutterPointData *data = point->data;
-  GstElement       *src;
-  GstElement       *capsfilter;
-  GstElement       *sink;
-  GstCaps          *caps;
-  gboolean          result;
+  gst_element_set_state (camera->pipeline, GST_STATE_NULL);
+  gst_object_unref (camera->pipeline);
+  camera->pipeline = NULL;
+}
+
+static void
+_destroy_camera (gpointer data)
+{
+  PPCamera *camera = data;
+
+  camera_close (camera);
+  clutter_actor_destroy (camera->texture);
+  g_free (camera->device);
+  g_free (camera->key);
+  g_slice_free (PPCamera, camera);
+}
+
+/* Drops a user of camera, it goes away with the last one */
+static void
+camera_unref (PPCamera *camera)
+{
+  if (--camera->users == 0)
+    g_hash_table_remove (camera->renderer->cameras, camera->key);
+}
 
-  if (texture)
+/* Of the raw video modes src offers, picks the smallest one that covers
+ * width by height, or the largest one if none does. Sizes given as ranges
+ * are taken as close to width by height as they go. Only modes with the
+ * framerate of the camera are taken if it has one.
+ */
+static GstCaps *
+camera_pick_mode (PPCamera   *camera,
+                  GstElement *src,
+                  gint        width,
+                  gint        height)
+{
+  GstStructure *best = NULL;
+  gboolean      best_covers = FALSE;
+  GstCaps      *caps, *result;
+  GstPad       *pad;
+  guint         i;
+
+  pad = gst_element_get_static_pad (src, "src");
+  caps = gst_pad_get_caps (pad);
+  gst_object_unref (pad);
+
+  for (i = 0; caps && i < gst_caps_get_size (caps); i++)
     {
-      data->background = clutter_clone_new (texture);
-      data->pipeline = pipeline;
+      GstStructure *mode;
+      gboolean      covers;
+      gint          w, h, n, d;
+
+      mode = gst_structure_copy (gst_caps_get_structure (caps, i));
+      if (!g_str_has_prefix (gst_structure_get_name (mode), "video/x-raw") ||
+          !gst_structure_fixate_field_nearest_int (mode, "width", width) ||
+          !gst_structure_fixate_field_nearest_int (mode, "height", height) ||
+          !gst_structure_get_int (mode, "width", &w) ||
+          !gst_structure_get_int (mode, "height", &h))
+        {
+          gst_structure_free (mode);
+          continue;
+        }
 
-      return TRUE;
+      if (camera->framerate)
+        {
+          if (!gst_structure_fixate_field_nearest_fraction (mode, "framerate",
+                                                            camera->framerate,
+                                                            1) ||
+              !gst_structure_get_fraction (mode, "framerate", &n, &d) ||
+              n != camera->framerate * d)
+            {
+              gst_structure_free (mode);
+              continue;
+            }
+        }
+
+      covers = w >= width && h >= height;
+      if (best)
+        {
+          gboolean better;
+          gint     bw, bh;
+
+          gst_structure_get_int (best, "width", &bw);
+          gst_structure_get_int (best, "height", &bh);
+          if (covers != best_covers)
+            better = covers;
+          else if (covers)
+            better = w * h < bw * bh;
+          else
+            better = w * h > bw * bh;
+
+          if (!better)
+            {
+              gst_structure_free (mode);
+              continue;
+            }
+          gst_structure_free (best);
+        }
+      best = mode;
+      best_covers = covers;
     }
+  if (caps)
+    gst_caps_unref (caps);
 
-  texture = g_object_new (CLUTTER_TYPE_TEXTURE, "disable-slicing", TRUE, NULL);
+  if (best == NULL)
+    return NULL;
 
-  g_signal_connect (CLUTTER_TEXTURE (texture),
-                    "size-change",
-                    G_CALLBACK (on_size_changed), renderer);
+  /* the rest, like the framerate when not asked for, is left to the
+   * camera */
+  result = gst_caps_new_simple (gst_structure_get_name (best), NULL);
+  gst_caps_set_value (result, "width", gst_structure_get_value (best, "width"));
+  gst_caps_set_value (result, "height", gst_structure_get_value (best, "height"));
+  if (camera->framerate)
+    gst_caps_set_value (result, "framerate",
+                        gst_structure_get_value (best, "framerate"));
+  gst_structure_free (best);
+
+  return result;
+}
+
+/* Opens the device of camera and sets up its pipeline, in the mode asked
+ * for or else in the smallest one covering the stage. The pipeline is left
+ * PAUSED.
+ */
+static gboolean
+camera_open (PPCamera *camera)
+{
+  ClutterRenderer *renderer = camera->renderer;
+  GstElement      *pipeline;
+  GstElement      *src;
+  GstElement      *capsfilter;
+  GstElement      *sink;
+  GstCaps         *caps = NULL;
+
+  if (camera->pipeline)
+    return TRUE;
+  if (camera->failed)
+    return FALSE;
 
-  /* Set up pipeline */
   pipeline = gst_pipeline_new (NULL);
 
   src = gst_element_factory_make ("v4l2src", NULL);
   if (src == NULL)
     {
       g_critical ("Failed to create v4l2src element");
-      g_object_unref (pipeline);
+      gst_object_unref (pipeline);
+      camera->failed = TRUE;
       return FALSE;
     }
 
-  capsfilter = gst_element_factory_make ("capsfilter", NULL);
-  sink = clutter_gst_video_sink_new (CLUTTER_TEXTURE (texture));
+  if (camera->device)
+    g_object_set (src, "device", camera->device, NULL);
 
-  /* make videotestsrc spit the format we want */
-  caps = gst_caps_new_simple ("video/x-raw-yuv", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  sink = clutter_gst_video_sink_new (CLUTTER_TEXTURE (camera->texture));
 
-  if (point->camera_framerate)
+  gst_bin_add_many (GST_BIN (pipeline), src, capsfilter, sink, NULL);
+  if (!gst_element_link_many (src, capsfilter, sink, NULL))
     {
-      gst_caps_set_simple (caps,
-                           "framerate", GST_TYPE_FRACTION,
-                           point->camera_framerate, 1,
-                           NULL);
+      g_critical ("Could not link elements");
+      gst_object_unref (pipeline);
+      camera->failed = TRUE;
+      return FALSE;
     }
 
-  if (pp_camera_device)
-    g_object_set (src, "device", pp_camera_device, NULL);
+  if (camera->resolution.width == 0 || camera->resolution.height == 0)
+    {
+      /* the device is open in READY, and tells what it can do */
+      if (gst_element_set_state (src, GST_STATE_READY) ==
+          GST_STATE_CHANGE_SUCCESS)
+        caps = camera_pick_mode (camera, src,
+                                 clutter_actor_get_width (renderer->stage),
+                                 clutter_actor_get_height (renderer->stage));
+    }
 
-#define W (point->camera_resolution.width)
-#define H (point->camera_resolution.height)
-  if (W != 0 && H != 0)
+  if (caps == NULL)
     {
-      gst_caps_set_simple (caps,
-                           "width", G_TYPE_INT, W,
-                           "height", G_TYPE_INT, H,
-                           NULL);
+      caps = gst_caps_new_simple ("video/x-raw-yuv", NULL);
+
+      if (camera->framerate)
+        gst_caps_set_simple (caps,
+                             "framerate", GST_TYPE_FRACTION,
+                             camera->framerate, 1,
+                             NULL);
+
+      if (camera->resolution.width != 0 && camera->resolution.height != 0)
+        gst_caps_set_simple (caps,
+                             "width", G_TYPE_INT, camera->resolution.width,
+                             "height", G_TYPE_INT, camera->resolution.height,
+                             NULL);
     }
-#undef W
-#undef H
 
   g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
 
-  gst_bin_add_many (GST_BIN (pipeline), src, capsfilter, sink, NULL);
-  result = gst_element_link_many (src, capsfilter, sink, NULL);
-  if (result == FALSE)
+  if (gst_element_set_state (pipeline, GST_STATE_PAUSED) ==
+      GST_STATE_CHANGE_FAILURE)
     {
-      g_critical("Could not link elements");
+      g_warning ("Could not open camera %s",
+                 camera->device ? camera->device : "");
+      gst_element_set_state (pipeline, GST_STATE_NULL);
       gst_object_unref (pipeline);
+      camera->failed = TRUE;
       return FALSE;
     }
 
-  data->background = texture;
-  data->pipeline = pipeline;
+  camera->pipeline = pipeline;
 
   return TRUE;
 }
+
+/* Opens the cameras of the current and the next slide, and closes all
+ * others, so devices are only held while they are about to be shown. A
+ * device can only be open once: when both slides show it in different
+ * modes, the next slide only gets it once it is the current one.
+ */
+static void
+cameras_update (ClutterRenderer *renderer)
+{
+  PinPointPoint  *current = pp_slide_current ();
+  PinPointPoint  *next = pp_slide_nth (pp_slideno + 1);
+  PPCamera       *wanted[2] = { NULL, NULL };
+  GHashTableIter  iter;
+  PPCamera       *camera;
+
+  if (current && current->bg_type == PP_BG_CAMERA)
+    wanted[0] = ((ClutterPointData *) current->data)->camera;
+  if (next && next->bg_type == PP_BG_CAMERA)
+    wanted[1] = ((ClutterPointData *) next->data)->camera;
+  if (wanted[0] && wanted[1] && wanted[0] != wanted[1] &&
+      g_strcmp0 (wanted[0]->device, wanted[1]->device) == 0)
+    wanted[1] = NULL;
+
+  /* closed first, so that their devices are free for the others; a device
+   * that was busy or unplugged gets another go once out of reach */
+  g_hash_table_iter_init (&iter, renderer->cameras);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &camera))
+    if (camera != wanted[0] && camera != wanted[1])
+      {
+        camera_close (camera);
+        camera->failed = FALSE;
+      }
+
+  if (wanted[0])
+    camera_open (wanted[0]);
+  if (wanted[1])
+    camera_open (wanted[1]);
+}
 #endif
 
 static gboolean
 clutter_renderer_make_point (PinPointRenderer *pp_renderer,
                              PinPointPoint    *point)
+{
+  ClutterRenderer  *renderer = CLUTTER_RENDERER (pp_renderer);
+  ClutterPointData *data     = point->data;
+  ClutterColor      color;
+  gboolean          ret = TRUE;
+
+  /* the actors are created by prepare_point () */
+  switch (point->bg_type)
+    {
+    case PP_BG_COLOR:
+      ret = clutter_color_from_string (&color, point->bg);
+      break;
+    case PP_BG_IMAGE:
+      {
+        char *file = _clutter_get_bg_path (renderer, point);
+        data->asset = _clutter_get_asset (renderer, file);
+        g_free (file);
+      }
+      break;
+    default:
+      break;
+    }
+
+  /* read once the first slide is up rather than holding it back */
+  if (pp_preload_transitions && point->transition &&
+      !g_hash_table_lookup (renderer->transitions, point->transition))
+    {
+      renderer->transition_preload =
+        g_slist_prepend (renderer->transition_preload,
+                         (char *) point->transition);
+      if (!renderer->transition_preload_idle)
+        renderer->transition_preload_idle =
+          g_idle_add_full (G_PRIORITY_LOW, transition_preload, renderer, NULL);
+    }
+
+  return ret;
+}
+
+/* Creates the actors of a slide, done for the slides around the current
+ * one only.
+ */
+static void
+clutter_renderer_prepare_point (PinPointRenderer *pp_renderer,
+                                PinPointPoint    *point)
 {
   ClutterRenderer  *renderer  = CLUTTER_RENDERER (pp_renderer);
   ClutterPointData *data      = point->data;
-  const char       *file      = point->bg;
-        char       *full_path = NULL;
+  char             *file;
   ClutterColor color;
-  gboolean ret = FALSE;
 
-  if (point->bg_type != PP_BG_COLOR && renderer->path && file)
-    {
-      char *dir = g_path_get_dirname (renderer->path);
-      full_path = g_build_filename (dir, file, NULL);
-      g_free (dir);
+  if (data->text)
+    return;
 
-      file = full_path;
-    }
+  file = _clutter_get_bg_path (renderer, point);
 
   switch (point->bg_type)
     {
     case PP_BG_COLOR:
       {
-        ret = clutter_color_from_string (&color, point->bg);
-        if (ret)
+        if (clutter_color_from_string (&color, point->bg))
           data->background = g_object_new (CLUTTER_TYPE_RECTANGLE,
                                            "color",  &color,
                                            "width",  100.0,
@@ -1166,8 +1891,7 @@ clutter_renderer_make_point (PinPointRenderer *pp_renderer,
       {
         ClutterColor black = {0, 0, 0, 255};
 
-        ret = clutter_color_from_string (&color, point->stage_color);
-        if (ret)
+        if (clutter_color_from_string (&color, point->stage_color))
           data->background = g_object_new (CLUTTER_TYPE_RECTANGLE,
                                            "color",  &color,
                                            "width",  100.0,
@@ -1182,22 +1906,18 @@ clutter_renderer_make_point (PinPointRenderer *pp_renderer,
       }
       break;
     case PP_BG_IMAGE:
-      data->background = _clutter_get_texture (renderer, file);
-      ret = TRUE;
+      data->background = clutter_clone_new (data->asset->texture);
       break;
     case PP_BG_VIDEO:
 #ifdef USE_CLUTTER_GST
-      data->background = clutter_gst_video_texture_new ();
-      clutter_media_set_filename (CLUTTER_MEDIA (data->background), file);
-      g_signal_connect (CLUTTER_TEXTURE (data->background),
-                        "size-change",
-                        G_CALLBACK (on_size_changed), renderer);
-      ret = TRUE;
+      /* the file is only opened by videos_update () */
+      data->background = video_texture_get (renderer);
 #endif
       break;
     case PP_BG_CAMERA:
 #ifdef USE_CLUTTER_GST
-      ret = setup_camera (pp_renderer, point);
+      data->camera = camera_get (renderer, point);
+      data->background = clutter_clone_new (data->camera->texture);
 #endif
       break;
     case PP_BG_SVG:
@@ -1221,7 +1941,6 @@ clutter_renderer_make_point (PinPointRenderer *pp_renderer,
                        file, error->message);
             g_clear_error (&error);
           }
-        ret = data->background != NULL;
       }
 #endif
       break;
@@ -1229,7 +1948,7 @@ clutter_renderer_make_point (PinPointRenderer *pp_renderer,
       g_assert_not_reached();
     }
 
-  g_free (full_path);
+  g_free (file);
 
   if (data->background)
     {
@@ -1263,16 +1982,40 @@ clutter_renderer_make_point (PinPointRenderer *pp_renderer,
   clutter_container_add_actor (CLUTTER_CONTAINER (renderer->foreground),
                                data->text);
 
-  clutter_actor_set_position (data->text, RESTX, renderer->rest_y);
-  data->rest_y = renderer->rest_y;
-  renderer->rest_y += clutter_actor_get_height (data->text);
+  if (!data->rest_assigned)
+    {
+      data->rest_y = renderer->rest_y;
+      renderer->rest_y += clutter_actor_get_height (data->text);
+      data->rest_assigned = TRUE;
+    }
+  clutter_actor_set_position (data->text, RESTX, data->rest_y);
   clutter_actor_set_depth (data->text, RESTDEPTH);
 
-  return ret;
+  if (point->bg_type == PP_BG_VIDEO)
+    videos_update (renderer);
+#ifdef USE_CLUTTER_GST
+  if (point->bg_type == PP_BG_CAMERA)
+    cameras_update (renderer);
+#endif
 }
 
-static void *
-clutter_renderer_allocate_data (PinPointRenderer *renderer)
+static void _clutter_release_actors (ClutterPointData *data);
+static void _clutter_release_preview (ClutterPointData *data);
+
+/* Gives up the actors and the speaker screen thumbnail of a slide that went
+ * out of reach, they are made again when it comes back
+ */
+static void
+clutter_renderer_release_point (PinPointRenderer *pp_renderer,
+                                PinPointPoint    *point)
+{
+  _clutter_release_actors (point->data);
+  _clutter_release_preview (point->data);
+}
+
+
+static void *
+clutter_renderer_allocate_data (PinPointRenderer *renderer)
 {
   ClutterPointData *data = g_slice_new0 (ClutterPointData);
   data->renderer = renderer;
@@ -1280,19 +2023,49 @@ clutter_renderer_allocate_data (PinPointRenderer *renderer)
 }
 
 static void
-clutter_renderer_free_data (PinPointRenderer *renderer,
-                            void             *datap)
+_clutter_release_actors (ClutterPointData *data)
 {
-  ClutterPointData *data = datap;
-
+  if (data->transition)
+    transition_release (data->transition);
+#ifdef USE_CLUTTER_GST
+  if (data->background && CLUTTER_GST_IS_VIDEO_TEXTURE (data->background))
+    video_release (CLUTTER_RENDERER (data->renderer), data);
+#endif
   if (data->background)
     clutter_actor_destroy (data->background);
+#ifdef USE_CLUTTER_GST
+  if (data->camera)
+    camera_unref (data->camera);
+  data->camera = NULL;
+#endif
   if (data->text)
     clutter_actor_destroy (data->text);
-  if (data->json_slide)
-    clutter_actor_destroy (data->json_slide);
-  if (data->script)
-    g_object_unref (data->script);
+  data->background = NULL;
+  data->text = NULL;
+}
+
+static void
+_clutter_release_preview (ClutterPointData *data)
+{
+  if (data->preview_job)
+    {
+      g_atomic_int_set (&data->preview_job->cancelled, TRUE);
+      data->preview_job->data = NULL;
+      data->preview_job = NULL;
+    }
+  if (data->preview)
+    cairo_surface_destroy (data->preview);
+  data->preview = NULL;
+}
+
+static void
+clutter_renderer_free_data (PinPointRenderer *renderer,
+                            void             *datap)
+{
+  ClutterPointData *data = datap;
+
+  _clutter_release_actors (data);
+  _clutter_release_preview (data);
   g_slice_free (ClutterPointData, data);
 }
 
@@ -1308,6 +2081,23 @@ static void end_of_presentation (ClutterRenderer *renderer)
 }
 
 
+/* Has the stills of all video slides taken in parallel, so that rendering
+ * their previews does not have to wait for it
+ */
+static void
+speaker_prefetch_thumbnails (ClutterRenderer *renderer)
+{
+#ifdef USE_CLUTTER_GST
+  if (!renderer->speaker_mode || !renderer->cairo_renderer)
+    return;
+  if (!renderer->thumbnails)
+    renderer->thumbnails = g_cancellable_new ();
+  cairo_renderer_prefetch_thumbnails (renderer->cairo_renderer,
+                                      PREVIEW_WIDTH, PREVIEW_HEIGHT,
+                                      renderer->thumbnails);
+#endif
+}
+
 static void
 toggle_speaker_screen (ClutterRenderer *renderer)
 {
@@ -1322,7 +2112,10 @@ toggle_speaker_screen (ClutterRenderer *renderer)
     {
       renderer->speaker_mode = TRUE;
       clutter_actor_show (renderer->speaker_screen);
+      speaker_invalidate (renderer, SPEAKER_DIRTY_ALL);
+      speaker_prefetch_thumbnails (renderer);
     }
+  speaker_timing_changed (renderer);
 }
 
 static void
@@ -1424,6 +2217,7 @@ key_pressed (ClutterActor    *actor,
           renderer->autoadvance = FALSE;
         else
           renderer->autoadvance = TRUE;
+        speaker_timing_changed (renderer);
         break;
       case CLUTTER_F11:
         case CLUTTER_F:
@@ -1487,11 +2281,12 @@ mouse_clicked (ClutterActor    *actor,
 static void leave_slide (ClutterRenderer *renderer,
                          gboolean         backwards)
 {
-  PinPointPoint *point = pp_slidep->data;
+  PinPointPoint *point = pp_slide_current ();
   ClutterPointData *data = point->data;
 
-  point->new_duration += g_timer_elapsed (renderer->timer, NULL) -
-                                          renderer->slide_start_time;
+  pp_slide_set_new_duration (pp_slideno, point->new_duration +
+                             g_timer_elapsed (renderer->timer, NULL) -
+                             renderer->slide_start_time);
 
   if (!point->transition)
     {
@@ -1513,21 +2308,21 @@ static void leave_slide (ClutterRenderer *renderer,
     }
   else
     {
-      if (data->script)
+      if (data->transition)
         {
           if (backwards)
-            clutter_state_set_state (data->state, "pre");
+            clutter_state_set_state (data->transition->state, "pre");
           else
-            clutter_state_set_state (data->state, "post");
+            clutter_state_set_state (data->transition->state, "post");
         }
     }
 
   if (data->background)
     {
 #ifdef USE_CLUTTER_GST
-      if (point->bg_type == PP_BG_CAMERA)
+      if (data->camera && data->camera->pipeline)
         {
-          gst_element_set_state (data->pipeline, GST_STATE_PAUSED);
+          gst_element_set_state (data->camera->pipeline, GST_STATE_PAUSED);
         }
       if (CLUTTER_GST_IS_VIDEO_TEXTURE (data->background))
         {
@@ -1553,27 +2348,16 @@ static void leave_slide (ClutterRenderer *renderer,
 
 static void state_completed (ClutterState *state, gpointer user_data)
 {
-  PinPointPoint    *point     = user_data;
-  ClutterPointData *data      = point->data;
-  const char       *new_state = clutter_state_get_state (state);
+  PPTransitionInstance *instance  = user_data;
+  const char           *new_state = clutter_state_get_state (state);
 
   if (new_state == g_intern_static_string ("post") ||
       new_state == g_intern_static_string ("pre"))
     {
-      clutter_actor_hide (data->json_slide);
-      if (data->background2)
-        {
-          clutter_actor_reparent (data->text, CLUTTER_RENDERER (data->renderer)->foreground);
-
-          g_object_set (data->text,
-                        "depth",   RESTDEPTH,
-                        "scale-x", 1.0,
-                        "scale-y", 1.0,
-                        "x",       RESTX,
-                        "y",       data->rest_y,
-                        NULL);
-          clutter_actor_set_opacity (data->background, 0);
-        }
+      /* the slide has been left, unless this is warping into place for
+         showing it */
+      if (instance->point && instance->point != pp_slide_current ())
+        transition_release (instance);
     }
 }
 
@@ -1584,14 +2368,14 @@ action_slide (ClutterRenderer *renderer)
   ClutterPointData *data;
   const char       *command = NULL;
 
-  if (!pp_slidep)
+  point = pp_slide_current ();
+  if (!point)
     return;
 
-  point = pp_slidep->data;
   data = point->data;
 
-  if (data->state)
-    clutter_state_set_state (data->state, "action");
+  if (data->transition)
+    clutter_state_set_state (data->transition->state, "action");
 
   command = clutter_text_get_text (CLUTTER_TEXT (renderer->commandline));
   if (command && *command)
@@ -1618,6 +2402,174 @@ static char *pp_lookup_transition (const char *transition)
   return NULL;
 }
 
+static void
+_destroy_transition (gpointer data)
+{
+  PPTransition *transition = data;
+  GList        *iter;
+
+  /* the actors went with the stage */
+  for (iter = transition->idle; iter; iter = iter->next)
+    {
+      PPTransitionInstance *instance = iter->data;
+
+      g_object_unref (instance->script);
+      g_slice_free (PPTransitionInstance, instance);
+    }
+  g_list_free (transition->idle);
+  g_free (transition->json);
+  g_free (transition->dir);
+  g_slice_free (PPTransition, transition);
+}
+
+static PPTransition *
+pp_get_transition (ClutterRenderer *renderer,
+                   const char      *name)
+{
+  PPTransition *transition;
+  char         *path;
+
+  transition = g_hash_table_lookup (renderer->transitions, name);
+  if (transition)
+    return transition;
+
+  transition = g_slice_new0 (PPTransition);
+  path = pp_lookup_transition (name);
+  if (path &&
+      g_file_get_contents (path, &transition->json, &transition->length, NULL))
+    transition->dir = g_path_get_dirname (path);
+  g_free (path);
+
+  g_hash_table_insert (renderer->transitions, g_strdup (name), transition);
+  return transition;
+}
+
+/* Reads one of the transitions queued by make_point () per iteration */
+static gboolean
+transition_preload (gpointer data)
+{
+  ClutterRenderer *renderer = data;
+  GSList          *first    = renderer->transition_preload;
+
+  if (!first)
+    {
+      renderer->transition_preload_idle = 0;
+      return FALSE;
+    }
+
+  renderer->transition_preload = g_slist_remove_link (first, first);
+  pp_get_transition (renderer, first->data);
+  g_slist_free_1 (first);
+  return TRUE;
+}
+
+static void state_completed (ClutterState *state,
+                             gpointer      user_data);
+
+/* Binds an instance of the transition of point to it, reusing an idle one
+ * when there is one.
+ */
+static PPTransitionInstance *
+transition_bind (ClutterRenderer  *renderer,
+                 PinPointPoint    *point,
+                 GError          **error)
+{
+  ClutterPointData     *data = point->data;
+  PPTransition         *transition;
+  PPTransitionInstance *instance;
+
+  transition = pp_get_transition (renderer, point->transition);
+  if (transition->idle)
+    {
+      instance = transition->idle->data;
+      transition->idle = g_list_delete_link (transition->idle,
+                                             transition->idle);
+    }
+  else
+    {
+      ClutterScript *script = clutter_script_new ();
+      ClutterActor  *json_slide;
+
+      if (transition->json)
+        {
+          clutter_script_add_search_paths (script,
+                               (const gchar * const *) &transition->dir, 1);
+          clutter_script_load_from_data (script, transition->json,
+                                         transition->length, error);
+        }
+      json_slide = CLUTTER_ACTOR (clutter_script_get_object (script, "actor"));
+      if (!json_slide)
+        {
+          g_object_unref (script);
+          return NULL;
+        }
+
+      instance = g_slice_new0 (PPTransitionInstance);
+      instance->renderer = renderer;
+      instance->transition = transition;
+      instance->script = script;
+      instance->json_slide = json_slide;
+      instance->foreground = CLUTTER_ACTOR (
+          clutter_script_get_object (script, "foreground"));
+      instance->midground = CLUTTER_ACTOR (
+          clutter_script_get_object (script, "midground"));
+      instance->background2 = CLUTTER_ACTOR (
+          clutter_script_get_object (script, "background"));
+      instance->state = CLUTTER_STATE (
+          clutter_script_get_object (script, "state"));
+
+      clutter_container_add_actor (CLUTTER_CONTAINER (renderer->json_layer),
+                                   instance->json_slide);
+      g_signal_connect (instance->state, "completed",
+                        G_CALLBACK (state_completed), instance);
+    }
+
+  instance->point = point;
+  data->transition = instance;
+  clutter_state_warp_to_state (instance->state, "pre");
+
+  if (instance->background2 && data->background) /* borrow the background */
+    {
+      clutter_actor_reparent (data->background, instance->background2);
+    }
+
+  return instance;
+}
+
+/* Hands the actors of the slide bound to an instance back to the renderer
+ * and returns the instance to the idle ones of its template.
+ */
+static void
+transition_release (PPTransitionInstance *instance)
+{
+  ClutterRenderer  *renderer = instance->renderer;
+  ClutterPointData *data     = instance->point->data;
+
+  if (clutter_actor_get_parent (data->text) != renderer->foreground)
+    clutter_actor_reparent (data->text, renderer->foreground);
+  g_object_set (data->text,
+                "depth",   RESTDEPTH,
+                "scale-x", 1.0,
+                "scale-y", 1.0,
+                "x",       RESTX,
+                "y",       data->rest_y,
+                NULL);
+
+  if (data->background &&
+      clutter_actor_get_parent (data->background) != renderer->background)
+    {
+      clutter_actor_reparent (data->background, renderer->background);
+      clutter_actor_set_opacity (data->background, 0);
+    }
+
+  data->transition = NULL;
+  instance->point = NULL;
+  clutter_actor_hide (instance->json_slide);
+
+  instance->transition->idle = g_list_prepend (instance->transition->idle,
+                                               instance);
+}
+
 static void update_commandline_shading (ClutterRenderer *renderer)
 {
   PinPointPoint *point;
@@ -1627,7 +2579,7 @@ static void update_commandline_shading (ClutterRenderer *renderer)
   float text_x,    text_y,    text_width,    text_height;
   float shading_x, shading_y, shading_width, shading_height;
 
-  point = pp_slidep->data;
+  point = pp_slide_current ();
   clutter_actor_get_size (renderer->commandline, &text_width, &text_height);
   clutter_actor_get_position (renderer->commandline, &text_x, &text_y);
   pp_get_shading_position_size (clutter_actor_get_width (renderer->stage),
@@ -1657,69 +2609,23 @@ static void update_commandline_shading (ClutterRenderer *renderer)
        NULL);
 }
 
-static gfloat point_time (ClutterRenderer *renderer,
-                          PinPointPoint   *point)
-{
-  GList *iter;
-  float time;
-  gboolean after_current = FALSE;
-
-  for (iter = pp_slides; iter && iter->data != point; iter = iter->next)
-    {
-      if (iter == pp_slidep)
-        after_current = TRUE;
-    }
-
-  time = point->duration != 0.0 ? point->duration : 2.0;
-  /* if before current point, use new time.. if at or after current point
-     use historic time
-   */
-  if (!after_current)
-    if (point->new_duration != 0.0)
-      time = point->new_duration;
-  return time;
-}
-
-static gfloat total_time (ClutterRenderer *renderer,
-                          GList *start)
-{
-  GList *iter;
-  gfloat total = 0;
-  if (!start)
-    start = pp_slides;
-  for (iter = start; iter; iter = iter->next)
-    {
-      total += point_time (renderer, iter->data);
-    }
-  return total;
-}
-
 static gfloat slide_rel_duration (ClutterRenderer *renderer,
-                                  GList *slide)
+                                  gint             slideno)
 {
-  return point_time (renderer, slide->data) / total_time (renderer, pp_slides);
+  return pp_timing_slide (slideno) / pp_timing_total ();
 }
 
 static gfloat slide_rel_start (ClutterRenderer *renderer,
-                               GList *slide)
+                               gint             slideno)
 {
-  GList *iter;
-  float time = 0;
-
-  for (iter = slide ->prev; iter; iter = iter->prev)
-    {
-      time += point_time (renderer, iter->data);
-    }
-
-  time = time / total_time (renderer, pp_slides);
-  return time;
+  return pp_timing_start (slideno) / pp_timing_total ();
 }
 
 static gfloat slide_time (ClutterRenderer *renderer,
-                          GList *slide)
+                          gint             slideno)
 {
-  float time = point_time (renderer, slide->data) /
-                     total_time (renderer, slide);
+  float time = pp_timing_slide (slideno) /
+                     pp_timing_remaining (slideno);
   float remaining_time = renderer->total_seconds -
                            g_timer_elapsed (renderer->timer, NULL);
   time *= remaining_time;
@@ -1727,101 +2633,291 @@ static gfloat slide_time (ClutterRenderer *renderer,
 }
 
 
-static gboolean update_speaker_screen (ClutterRenderer *renderer)
+static gboolean speaker_deadline (gpointer data);
+
+/* Checks the time spent on the current slide against the time budgeted for
+ * it; updates the warning, autoadvances and arms a timeout for the moment
+ * the outcome changes next.
+ */
+static void
+speaker_update_timing (ClutterRenderer *renderer)
 {
-  PinPointPoint *point;
+  PinPointPoint *point = pp_slide_current ();
+  float warn_time = SLIDE_WARN_TIME;
+  float elapsed;
+  float next = 0.0;
+  gint  opacity;
 
-  if (!pp_slidep)
-    return FALSE;
+  if (renderer->speaker_deadline)
+    {
+      g_source_remove (renderer->speaker_deadline);
+      renderer->speaker_deadline = 0;
+    }
 
-  point = pp_slidep->data;
-  static float current_slide_time = 0.0;
-  static float current_slide_duration = 0.0;
-  static GList *current_slide = NULL;
-  float nh, nw;
+  if (!point)
+    return;
 
-  if (renderer->reset)
+  if (renderer->speaker_slide != point)
     {
-      current_slide = NULL;
-      current_slide_duration = 0.0;
-      current_slide_time = 0.0;
-      renderer->reset = FALSE;
+      renderer->speaker_slide = point;
+      renderer->speaker_slide_start = g_timer_elapsed (renderer->timer, NULL);
+      renderer->speaker_slide_duration = slide_time (renderer, pp_slideno);
     }
 
-    {
-      static float current_slide_prev_time = 0.0;
-      float warn_time = SLIDE_WARN_TIME;
-      float diff = g_timer_elapsed (renderer->timer, NULL) - current_slide_prev_time;
+  /* if 33% of the slide is longer than the seconds based threshold, use
+     the percentage
+   */
+  if ((warn_time <= renderer->speaker_slide_duration * SLIDE_WARN_THRESHOLD))
+    warn_time =     renderer->speaker_slide_duration * SLIDE_WARN_THRESHOLD;
 
-      if (current_slide != pp_slidep)
+  elapsed = g_timer_elapsed (renderer->timer, NULL) -
+              renderer->speaker_slide_start;
+  if (elapsed >= renderer->speaker_slide_duration)
+    {
+      if (renderer->autoadvance)
         {
-          current_slide_time = 0;
-          current_slide = pp_slidep;
-          current_slide_duration = slide_time (renderer, pp_slidep);
+          gint slideno = pp_slideno;
+
+          next_slide (renderer);
+          if (pp_slideno != slideno)
+            return; /* show_slide () took over */
         }
+      opacity = OPACITY_OVER_TIME;
+    }
+  else if ((renderer->speaker_slide_duration - elapsed < warn_time))
+    {
+      opacity = OPACITY_PAST_THRESHOLD;
+      next = renderer->speaker_slide_duration - elapsed;
+    }
+  else
+    {
+      opacity = OPACITY_OK;
+      next = renderer->speaker_slide_duration - warn_time - elapsed;
+    }
 
-      /* if 33% of the slide is longer than the seconds based threshold, use
-         the percentage
-       */
-      if ((warn_time <= current_slide_duration * SLIDE_WARN_THRESHOLD))
-        warn_time =     current_slide_duration * SLIDE_WARN_THRESHOLD;
+  if (opacity != renderer->speaker_warning &&
+      renderer->speaker_slide_prog_warning)
+    {
+      clutter_actor_animate (renderer->speaker_slide_prog_warning,
+                             CLUTTER_LINEAR, opacity == OPACITY_OK ? 50 : 500,
+                             "opacity", opacity,
+                             NULL);
+      renderer->speaker_warning = opacity;
+    }
+
+  /* nobody is watching the clock without the speaker screen, unless it
+     drives the slides */
+  if (next > 0.0 && !renderer->timer_paused &&
+      (renderer->speaker_mode || renderer->autoadvance))
+    renderer->speaker_deadline = g_timeout_add (next * 1000 + 1,
+                                                speaker_deadline, renderer);
+}
+
+static gboolean
+speaker_deadline (gpointer data)
+{
+  ClutterRenderer *renderer = data;
+
+  renderer->speaker_deadline = 0;
+  speaker_update_timing (renderer);
+  return FALSE;
+}
+
+static gboolean
+speaker_tick (gpointer data)
+{
+  speaker_invalidate (data, SPEAKER_DIRTY_TIME);
+  return TRUE;
+}
+
+/* To be called whenever the timer is paused or resumed, autoadvance is
+ * toggled or the speaker screen is shown or hidden.
+ */
+static void
+speaker_timing_changed (ClutterRenderer *renderer)
+{
+  gboolean ticking = renderer->speaker_mode && !renderer->timer_paused;
+
+  if (ticking && !renderer->speaker_tick)
+    renderer->speaker_tick = g_timeout_add_seconds (1, speaker_tick, renderer);
+  else if (!ticking && renderer->speaker_tick)
+    {
+      g_source_remove (renderer->speaker_tick);
+      renderer->speaker_tick = 0;
+    }
+
+  speaker_update_timing (renderer);
+  /* the button labels might have changed */
+  speaker_invalidate (renderer, SPEAKER_DIRTY_TIME | SPEAKER_DIRTY_LAYOUT);
+}
+
+static gboolean
+preview_done (gpointer user_data)
+{
+  PreviewJob      *job      = user_data;
+  ClutterRenderer *renderer = job->renderer;
+  gint             i;
+
+  if (job->data)
+    {
+      job->data->preview_job = NULL;
+      if (job->data->preview)
+        cairo_surface_destroy (job->data->preview);
+      job->data->preview = job->surface;
+      job->surface = NULL;
 
-      current_slide_time += diff;
-      if (current_slide_time >= current_slide_duration)
+      for (i = pp_slideno - 1; i <= pp_slideno + 1; i++)
         {
-          if (renderer->autoadvance)
+          PinPointPoint *point = pp_slide_nth (i);
+
+          if (point && point->data == job->data)
             {
-              current_slide_time = 0;
-              next_slide (renderer);
+              renderer->speaker_previews = NULL;
+              speaker_invalidate (renderer, SPEAKER_DIRTY_SLIDE);
             }
+        }
+    }
 
+  if (job->surface)
+    cairo_surface_destroy (job->surface);
+  g_slice_free (PreviewJob, job);
+  return FALSE;
+}
 
-          if (renderer->speaker_slide_prog_warning)
-            clutter_actor_animate (renderer->speaker_slide_prog_warning,
-                                   CLUTTER_LINEAR, 500,
-                                   "opacity", OPACITY_OVER_TIME,
-                                   NULL);
-        }
+/* Runs in the preview thread, the only user of renderer->cairo_renderer */
+static void
+preview_render (gpointer job_data,
+                gpointer user_data)
+{
+  PreviewJob   *job = job_data;
+  GMainContext *context;
+  cairo_t      *cr;
 
+  if (!g_atomic_int_get (&job->cancelled))
+    {
+      /* keep the video thumbnailer from spinning the main context */
+      context = g_main_context_new ();
+      g_main_context_push_thread_default (context);
+
+      job->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                 job->width, job->height);
+      cr = cairo_create (job->surface);
+      cairo_renderer_set_cr (job->renderer->cairo_renderer,
+                             cr, job->width, job->height);
+      cairo_renderer_render_page (job->renderer->cairo_renderer, &job->point);
+      cairo_renderer_unset_cr (job->renderer->cairo_renderer);
+      cairo_destroy (cr);
+
+      g_main_context_pop_thread_default (context);
+      g_main_context_unref (context);
+    }
 
-      else if ((current_slide_duration - current_slide_time < warn_time))
-        {
-          if (renderer->speaker_slide_prog_warning)
-            clutter_actor_animate (renderer->speaker_slide_prog_warning,
-                                   CLUTTER_LINEAR, 500,
-                                   "opacity", OPACITY_PAST_THRESHOLD,
-                                   NULL);
-        }
-      else
-        {
-          if (renderer->speaker_slide_prog_warning)
-            clutter_actor_animate (renderer->speaker_slide_prog_warning,
-                                   CLUTTER_LINEAR, 50,
-                                   "opacity", OPACITY_OK,
-                                   NULL);
-        }
+  g_idle_add (preview_done, job);
+}
+
+/* Queues rendering the thumbnail of a slide unless it is cached or already
+ * underway.
+ */
+static void
+preview_request (ClutterRenderer *renderer,
+                 PinPointPoint   *point)
+{
+  ClutterPointData *data;
+  PreviewJob       *job;
+
+  if (!point)
+    return;
+
+  data = point->data;
+  if (data->preview_job)
+    return;
+  if (data->preview &&
+      cairo_image_surface_get_width (data->preview) == PREVIEW_WIDTH &&
+      cairo_image_surface_get_height (data->preview) == PREVIEW_HEIGHT)
+    return;
+
+  job = g_slice_new0 (PreviewJob);
+  job->renderer = renderer;
+  job->data = data;
+  job->point = *point;
+  /* the worker gets no pointers it doesn't need into data the main
+     thread owns and frees */
+  job->point.speaker_notes = NULL;
+  job->point.source = NULL;
+  job->point.data = NULL;
+  job->width = PREVIEW_WIDTH;
+  job->height = PREVIEW_HEIGHT;
+
+  data->preview_job = job;
+  g_thread_pool_push (renderer->preview_pool, job, NULL);
+}
+
+/* Shows the cached thumbnail of point, if any, in a preview actor */
+static void
+preview_show (ClutterActor  *preview,
+              PinPointPoint *point)
+{
+  ClutterPointData *data = point ? point->data : NULL;
+  cairo_t          *cr;
 
-      current_slide_prev_time = g_timer_elapsed (renderer->timer, NULL);
+  if (!data || !data->preview)
+    {
+      clutter_cairo_texture_clear (CLUTTER_CAIRO_TEXTURE (preview));
+      return;
     }
 
-  if (!renderer->speaker_mode)
-    return TRUE;
+  cr = clutter_cairo_texture_create (CLUTTER_CAIRO_TEXTURE (preview));
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, data->preview, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+}
 
-  if (point->speaker_notes)
-    clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_notes),
-                           point->speaker_notes);
-  else
-    clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_notes), "");
+static gboolean update_speaker_screen (ClutterRenderer *renderer)
+{
+  PinPointPoint *point;
+  guint dirty = renderer->speaker_dirty;
+  float nh, nw;
+
+  renderer->speaker_update = 0;
+
+  point = pp_slide_current ();
+  if (!point || !renderer->speaker_mode)
+    return FALSE;
+  renderer->speaker_dirty = 0;
 
   nw = clutter_actor_get_width (renderer->speaker_screen) + 1;
   nh = clutter_actor_get_height (renderer->speaker_screen);
 
+  if (dirty & SPEAKER_DIRTY_SLIDE)
+    {
+      if (point->speaker_notes)
+        clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_notes),
+                               point->speaker_notes);
+      else
+        clutter_text_set_text (CLUTTER_TEXT (renderer->speaker_notes), "");
+
+      if (renderer->speaker_previews != point)
+        {
+          /* the slide after next is rendered ahead of navigation */
+          preview_request (renderer, point);
+          preview_request (renderer, pp_slide_nth (pp_slideno + 1));
+          preview_request (renderer, pp_slide_nth (pp_slideno - 1));
+          preview_request (renderer, pp_slide_nth (pp_slideno + 2));
+
+          preview_show (renderer->speaker_prev, pp_slide_nth (pp_slideno - 1));
+          preview_show (renderer->speaker_current, point);
+          preview_show (renderer->speaker_next, pp_slide_nth (pp_slideno + 1));
+          renderer->speaker_previews = point;
+        }
+
+      /* the slide progress moves along */
+      dirty |= SPEAKER_DIRTY_LAYOUT;
+    }
+
+  if (dirty & SPEAKER_DIRTY_TIME)
   { /* should draw rectangles representing progress instead... */
     GString *str = g_string_new ("");
-    int i;
-    GList *iter;
-    for (iter = pp_slides, i=0; iter && iter != pp_slidep;
-         iter = iter->next, i++);
 
     {
       int time;
@@ -1846,7 +2942,12 @@ static gboolean update_speaker_screen (ClutterRenderer *renderer)
     g_string_free (str, TRUE);
   }
 
+  if (dirty & SPEAKER_DIRTY_LAYOUT)
   {
+    float height = 32;
+    float y = nh - height;
+    float scale;
+
 #define append_ltr(a,b) \
   clutter_actor_set_x (b, clutter_actor_get_x (a) + clutter_actor_get_width (a) + 20)
 
@@ -1856,12 +2957,6 @@ static gboolean update_speaker_screen (ClutterRenderer *renderer)
     append_ltr (renderer->speaker_pause, renderer->speaker_autoadvance);
     append_ltr (renderer->speaker_autoadvance, renderer->speaker_rehearse);
     append_ltr (renderer->speaker_rehearse, renderer->speaker_fullscreen);
-  }
-
-  {
-    float height = 32;
-    float y = clutter_actor_get_height (renderer->speaker_screen) - height;
-    float elapsed_part = g_timer_elapsed (renderer->timer, NULL) / renderer->total_seconds;
 
     clutter_actor_set_height (renderer->speaker_prog_bg, height);
     clutter_actor_set_height (renderer->speaker_prog_slide, height * 0.7);
@@ -1883,95 +2978,214 @@ static gboolean update_speaker_screen (ClutterRenderer *renderer)
 
     clutter_actor_set_width (renderer->speaker_prog_bg, nw);
 
+    clutter_actor_set_width (renderer->speaker_prog_slide,
+                             nw * slide_rel_duration (renderer, pp_slideno));
+    clutter_actor_set_x (renderer->speaker_prog_slide,
+                         nw * slide_rel_start (renderer, pp_slideno));
+
+    scale = nh / clutter_actor_get_height (renderer->speaker_next) * 0.4;
+    clutter_actor_set_scale (renderer->speaker_prev, scale, scale);
+    clutter_actor_set_scale (renderer->speaker_current, scale, scale);
+    clutter_actor_set_scale (renderer->speaker_next, scale, scale);
+
+    clutter_actor_set_position (renderer->speaker_prev,
+                                nw * 0.0,
+                                nh * -0.1);
+    clutter_actor_set_position (renderer->speaker_current,
+                                nw * 0.0,
+                                nh * 0.3);
+    clutter_actor_set_position (renderer->speaker_next,
+                                nw * 0.0,
+                                nh * 0.7);
+    clutter_actor_set_position (renderer->speaker_notes,
+                                nw * 0.46,
+                                nh * 0.35);
+    clutter_actor_set_width    (renderer->speaker_notes,
+                                nw * 0.5);
+  }
+
+  if (dirty & (SPEAKER_DIRTY_TIME | SPEAKER_DIRTY_LAYOUT))
+  {
+    float elapsed_part = g_timer_elapsed (renderer->timer, NULL) / renderer->total_seconds;
 
     clutter_actor_set_position (renderer->speaker_time_remaining,
        nw - clutter_actor_get_width (renderer->speaker_time_remaining),
        nh - clutter_actor_get_height (renderer->speaker_time_remaining) - 4);
 
-    clutter_actor_set_width (renderer->speaker_prog_slide,
-                             nw * slide_rel_duration (renderer, pp_slidep));
-    clutter_actor_set_x (renderer->speaker_prog_slide,
-                         nw * slide_rel_start (renderer, pp_slidep));
-
     clutter_actor_set_x (renderer->speaker_prog_time, nw * elapsed_part);
-
     clutter_actor_set_width (renderer->speaker_prog_time, nw * (1.0-elapsed_part));
+  }
 
+  return FALSE;
+}
 
-    elapsed_part = current_slide_time / current_slide_duration;
-  }
+/* Queues an update of the given parts of the speaker screen; updates are
+ * folded together and applied before the next redraw.
+ */
+static void
+speaker_invalidate (ClutterRenderer *renderer,
+                    guint            dirty)
+{
+  renderer->speaker_dirty |= dirty;
+  if (renderer->speaker_mode && !renderer->speaker_update)
+    renderer->speaker_update =
+      g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                       (GSourceFunc) update_speaker_screen, renderer, NULL);
+}
 
-  {
-    float scale;
-    scale = nh / clutter_actor_get_height (renderer->speaker_next) * 0.4;
-    clutter_actor_set_scale (renderer->speaker_prev, scale, scale);
-    clutter_actor_set_scale (renderer->speaker_current, scale, scale);
-    clutter_actor_set_scale (renderer->speaker_next, scale, scale);
-  }
+/*
+ * Videos
+ *
+ * Video textures only open their file, and with it get a running decoder,
+ * while their slide is the current, next or previous one. At most
+ * pp_video_pipelines are running, the others are stopped all the way down
+ * to the NULL state. The textures of released slides are kept for reuse.
+ */
 
-  {
-    static GList *current_slide = NULL;
-    if (current_slide != pp_slidep)
-      {
-        cairo_t *cr;
-
-        /*************/
-        cr = clutter_cairo_texture_create (CLUTTER_CAIRO_TEXTURE (renderer->speaker_prev));
-        cairo_renderer_set_cr (renderer->cairo_renderer,
-                               cr, clutter_actor_get_width (renderer->speaker_prev),
-                               clutter_actor_get_height (renderer->speaker_prev));
-        if (pp_slidep->prev)
-          cairo_renderer_render_page (renderer->cairo_renderer,
-                                      pp_slidep->prev->data);
-        else
-          cairo_renderer_render_page (renderer->cairo_renderer,
-                                      NULL);
-        cairo_renderer_unset_cr (renderer->cairo_renderer);
-        cairo_destroy (cr);
-
-        /*************/
-        cr = clutter_cairo_texture_create (CLUTTER_CAIRO_TEXTURE (renderer->speaker_current));
-        cairo_renderer_set_cr (renderer->cairo_renderer,
-                               cr, clutter_actor_get_width (renderer->speaker_current),
-                               clutter_actor_get_height (renderer->speaker_current));
-        cairo_renderer_render_page (renderer->cairo_renderer,
-                                    pp_slidep->data);
-        cairo_renderer_unset_cr (renderer->cairo_renderer);
-        cairo_destroy (cr);
-
-        /*************/
-        cr = clutter_cairo_texture_create (CLUTTER_CAIRO_TEXTURE (renderer->speaker_next));
-        cairo_renderer_set_cr (renderer->cairo_renderer,
-                               cr, clutter_actor_get_width (renderer->speaker_next),
-                               clutter_actor_get_height (renderer->speaker_next));
-        if (pp_slidep->next)
-          cairo_renderer_render_page (renderer->cairo_renderer,
-                                      pp_slidep->next->data);
-        else
-          cairo_renderer_render_page (renderer->cairo_renderer,
-                                      NULL);
-        cairo_renderer_unset_cr (renderer->cairo_renderer);
-        cairo_destroy (cr);
-        /*************/
-        current_slide = pp_slidep;
+#ifdef USE_CLUTTER_GST
+
+static ClutterActor *
+video_texture_get (ClutterRenderer *renderer)
+{
+  ClutterActor *texture;
+
+  if (renderer->video_pool)
+    {
+      texture = renderer->video_pool->data;
+      renderer->video_pool = g_slist_delete_link (renderer->video_pool,
+                                                  renderer->video_pool);
+      /* hand our reference over to the container it goes into */
+      g_object_force_floating (G_OBJECT (texture));
+      return texture;
     }
-  }
 
-  clutter_actor_set_position (renderer->speaker_prev,
-                              nw * 0.0,
-                              nh * -0.1);
-  clutter_actor_set_position (renderer->speaker_current,
-                              nw * 0.0,
-                              nh * 0.3);
-  clutter_actor_set_position (renderer->speaker_next,
-                              nw * 0.0,
-                              nh * 0.7);
-  clutter_actor_set_position (renderer->speaker_notes,
-                              nw * 0.46,
-                              nh * 0.35);
-  clutter_actor_set_width    (renderer->speaker_notes,
-                              nw * 0.5);
-  return TRUE;
+  texture = clutter_gst_video_texture_new ();
+  g_signal_connect (CLUTTER_TEXTURE (texture),
+                    "size-change",
+                    G_CALLBACK (on_size_changed), renderer);
+
+  return texture;
+}
+
+static void
+video_texture_free (gpointer texture)
+{
+  clutter_actor_destroy (texture);
+  g_object_unref (texture);
+}
+
+static GstElement *
+video_get_pipeline (ClutterPointData *data)
+{
+  return clutter_gst_video_texture_get_pipeline (
+           CLUTTER_GST_VIDEO_TEXTURE (data->background));
+}
+
+/* Brings the video of point to PAUSED, with its first frame decoded and in
+ * the texture, so that it starts right away when its slide is shown and its
+ * transition shows a real frame.
+ */
+static void
+video_load (ClutterRenderer *renderer,
+            PinPointPoint   *point)
+{
+  ClutterPointData *data = point->data;
+  char             *file;
+
+  if (g_list_find (renderer->videos_live, data))
+    return;
+
+  if (!data->video_opened)
+    {
+      file = _clutter_get_bg_path (renderer, point);
+      clutter_media_set_filename (CLUTTER_MEDIA (data->background), file);
+      g_free (file);
+      data->video_opened = TRUE;
+    }
+  gst_element_set_state (video_get_pipeline (data), GST_STATE_PAUSED);
+
+  renderer->videos_live = g_list_prepend (renderer->videos_live, data);
+}
+
+/* Stops the decoder of a video and frees its buffers, the texture keeps
+ * the file and the last frame */
+static void
+video_unload (ClutterRenderer  *renderer,
+              ClutterPointData *data)
+{
+  renderer->videos_live = g_list_remove (renderer->videos_live, data);
+
+  if (clutter_media_get_playing (CLUTTER_MEDIA (data->background)))
+    clutter_media_set_playing (CLUTTER_MEDIA (data->background), FALSE);
+  gst_element_set_state (video_get_pipeline (data), GST_STATE_NULL);
+}
+
+/* Takes the video texture away from a slide that is released, keeping it
+ * for another slide if there are few enough kept already.
+ */
+static void
+video_release (ClutterRenderer  *renderer,
+               ClutterPointData *data)
+{
+  ClutterActor *texture = data->background;
+  ClutterActor *parent;
+
+  video_unload (renderer, data);
+  data->video_opened = FALSE;
+
+  if (g_slist_length (renderer->video_pool) >= MAX (pp_video_pipelines, 1))
+    return; /* destroyed with the other actors */
+
+  data->background = NULL;
+  clutter_actor_detach_animation (texture);
+  g_object_ref (texture);
+  parent = clutter_actor_get_parent (texture);
+  if (parent)
+    clutter_container_remove_actor (CLUTTER_CONTAINER (parent), texture);
+  renderer->video_pool = g_slist_prepend (renderer->video_pool, texture);
+}
+
+#endif /* USE_CLUTTER_GST */
+
+/* Starts the decoders of the videos around the current slide, the current
+ * one first, then the next and the previous one, and stops all others.
+ */
+static void
+videos_update (ClutterRenderer *renderer)
+{
+#ifdef USE_CLUTTER_GST
+  static const gint  window[] = { 0, 1, -1 };
+  PinPointPoint     *wanted[G_N_ELEMENTS (window)];
+  gint               n_wanted = 0, i;
+  GList             *l, *next;
+
+  for (i = 0; i < (gint) G_N_ELEMENTS (window); i++)
+    {
+      PinPointPoint    *point = pp_slide_nth (pp_slideno + window[i]);
+      ClutterPointData *data;
+
+      if (!point || point->bg_type != PP_BG_VIDEO)
+        continue;
+      data = point->data;
+      if (data->background &&
+          CLUTTER_GST_IS_VIDEO_TEXTURE (data->background) &&
+          n_wanted < MAX (pp_video_pipelines, 1))
+        wanted[n_wanted++] = point;
+    }
+
+  for (l = renderer->videos_live; l; l = next)
+    {
+      next = l->next;
+      for (i = 0; i < n_wanted; i++)
+        if (wanted[i]->data == l->data)
+          break;
+      if (i == n_wanted)
+        video_unload (renderer, l->data);
+    }
+
+  for (i = 0; i < n_wanted; i++)
+    video_load (renderer, wanted[i]);
+#endif
 }
 
 static void
@@ -1981,12 +3195,19 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
   ClutterPointData *data;
   ClutterColor      color;
 
-  if (!pp_slidep)
+  point = pp_slide_current ();
+  if (!point)
     return;
 
   renderer->slide_start_time = g_timer_elapsed (renderer->timer, NULL);
 
-  point = pp_slidep->data;
+  pp_slides_prepare (PINPOINT_RENDERER (renderer));
+  asset_prefetch (renderer);
+  videos_update (renderer);
+#ifdef USE_CLUTTER_GST
+  cameras_update (renderer);
+#endif
+
   data = point->data;
 
   if (point->stage_color)
@@ -2002,11 +3223,15 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
 #ifdef USE_CLUTTER_GST
       if (point->bg_type == PP_BG_CAMERA)
         {
-          gst_element_set_state (data->pipeline, GST_STATE_PLAYING);
+          if (data->camera->pipeline)
+            gst_element_set_state (data->camera->pipeline, GST_STATE_PLAYING);
         }
       else if (CLUTTER_GST_IS_VIDEO_TEXTURE (data->background))
         {
-          clutter_media_set_progress (CLUTTER_MEDIA (data->background), 0.0);
+          /* a prerolled video is at its start already, seeking would
+           * throw away the decoded frame */
+          if (clutter_media_get_progress (CLUTTER_MEDIA (data->background)) > 0.0)
+            clutter_media_set_progress (CLUTTER_MEDIA (data->background), 0.0);
           clutter_media_set_playing (CLUTTER_MEDIA (data->background), TRUE);
         }
       else
@@ -2108,6 +3333,7 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
     }
   else
     {
+      PPTransitionInstance *instance;
       GError *error = NULL;
       /* fade out global group of texts when using a custom .json template */
       clutter_actor_animate (renderer->foreground,
@@ -2122,57 +3348,32 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
                              CLUTTER_LINEAR, 500,
                              "opacity",      0,
                              NULL);
-      if (!data->script)
+      if (!data->transition && !transition_bind (renderer, point, &error))
         {
-          char *path = pp_lookup_transition (point->transition);
-          data->script = clutter_script_new ();
-          clutter_script_load_from_file (data->script, path, &error);
-          g_free (path);
-          data->foreground = CLUTTER_ACTOR (
-              clutter_script_get_object (data->script, "foreground"));
-          data->midground = CLUTTER_ACTOR (
-              clutter_script_get_object (data->script, "midground"));
-          data->background2 = CLUTTER_ACTOR (
-              clutter_script_get_object (data->script, "background"));
-          data->state = CLUTTER_STATE (
-              clutter_script_get_object (data->script, "state"));
-          data->json_slide = CLUTTER_ACTOR (
-              clutter_script_get_object (data->script, "actor"));
-
-          clutter_container_add_actor (CLUTTER_CONTAINER (renderer->json_layer),
-                                       data->json_slide);
-          g_signal_connect (data->state, "completed",
-                            G_CALLBACK (state_completed), point);
-          clutter_state_warp_to_state (data->state, "pre");
-
-          if (data->background2) /* parmanently steal background */
-            {
-              clutter_actor_reparent (data->background, data->background2);
-            }
+          g_warning ("failed to load transition %s %s\n",
+                     point->transition, error?error->message:"");
+          g_clear_error (&error);
+          return;
         }
+      instance = data->transition;
 
-      clutter_actor_set_size (data->json_slide,
-                              clutter_actor_get_width (renderer->stage),
-                              clutter_actor_get_height (renderer->stage));
-
-      clutter_actor_set_size (data->foreground,
+      clutter_actor_set_size (instance->json_slide,
                               clutter_actor_get_width (renderer->stage),
                               clutter_actor_get_height (renderer->stage));
 
-      clutter_actor_set_size (data->background2,
-                              clutter_actor_get_width (renderer->stage),
-                              clutter_actor_get_height (renderer->stage));
+      if (instance->foreground)
+        clutter_actor_set_size (instance->foreground,
+                                clutter_actor_get_width (renderer->stage),
+                                clutter_actor_get_height (renderer->stage));
 
-      if (!data->json_slide)
-        {
-          g_warning ("failed to load transition %s %s\n",
-                     point->transition, error?error->message:"");
-          return;
-        }
+      if (instance->background2)
+        clutter_actor_set_size (instance->background2,
+                                clutter_actor_get_width (renderer->stage),
+                                clutter_actor_get_height (renderer->stage));
 
-      if (data->foreground)
+      if (instance->foreground)
         {
-          clutter_actor_reparent (data->text, data->foreground);
+          clutter_actor_reparent (data->text, instance->foreground);
         }
 
       clutter_actor_set_opacity (data->background, 255);
@@ -2210,18 +3411,18 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
                 &shading_x, &shading_y,
                 &shading_width, &shading_height);
 
-           if (!data->shading)
+           if (!instance->shading)
              {
-               data->shading = clutter_rectangle_new_with_color (&black);
+               instance->shading = clutter_rectangle_new_with_color (&black);
 
                clutter_container_add_actor (
-                   CLUTTER_CONTAINER (data->midground), data->shading);
-               clutter_actor_set_size (data->midground,
+                   CLUTTER_CONTAINER (instance->midground), instance->shading);
+               clutter_actor_set_size (instance->midground,
                                     clutter_actor_get_width (renderer->stage),
                                     clutter_actor_get_height (renderer->stage));
              }
 
-           g_object_set (data->shading,
+           g_object_set (instance->shading,
                   "depth",  -0.01,
                   "x",      shading_x,
                   "y",      shading_y,
@@ -2232,19 +3433,19 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
                   NULL);
          }
        else /* no text, fade out shading */
-         if (data->shading)
-           g_object_set (data->shading, "opacity", 0, NULL);
-       if (data->foreground)
+         if (instance->shading)
+           g_object_set (instance->shading, "opacity", 0, NULL);
+       if (instance->foreground)
          {
-           clutter_actor_reparent (data->text, data->foreground);
+           clutter_actor_reparent (data->text, instance->foreground);
          }
       }
 
       if (!backwards)
-        clutter_actor_raise_top (data->json_slide);
+        clutter_actor_raise_top (instance->json_slide);
 
-      clutter_actor_show (data->json_slide);
-      clutter_state_set_state (data->state, "show");
+      clutter_actor_show (instance->json_slide);
+      clutter_state_set_state (instance->state, "show");
     }
 
   /* render potentially executed commands */
@@ -2285,10 +3486,8 @@ show_slide (ClutterRenderer *renderer, gboolean backwards)
    update_commandline_shading (renderer);
   }
 
-  if (renderer->speaker_mode)
-    {
-      update_speaker_screen (renderer);
-    }
+  speaker_update_timing (renderer);
+  speaker_invalidate (renderer, SPEAKER_DIRTY_SLIDE);
 }
 
 static void
@@ -2297,11 +3496,38 @@ stage_resized (ClutterActor    *actor,
                ClutterRenderer *renderer)
 {
   show_slide (renderer, FALSE); /* redisplay the current slide */
-  update_speaker_screen (renderer);
+  speaker_invalidate (renderer, SPEAKER_DIRTY_LAYOUT);
 }
 
 static guint reload_tag = 0;
 
+/* Hands out the places texts rest at from the start again, in the order of
+ * the slides. Slides that are not prepared get theirs when they are.
+ */
+static void
+reset_rest_places (ClutterRenderer *renderer)
+{
+  guint i;
+
+  renderer->rest_y = STARTPOS;
+  for (i = 0; i < pp_slide_count (); i++)
+    {
+      PinPointPoint    *point = pp_slide_nth (i);
+      ClutterPointData *data = point->data;
+
+      data->rest_assigned = FALSE;
+      if (!data->text)
+        continue;
+
+      data->rest_y = renderer->rest_y;
+      renderer->rest_y += clutter_actor_get_height (data->text);
+      data->rest_assigned = TRUE;
+      /* the current text goes to its new place when the slide is left */
+      if ((gint) i != pp_slideno)
+        clutter_actor_set_position (data->text, RESTX, data->rest_y);
+    }
+}
+
 static gboolean
 reload (gpointer data)
 {
@@ -2311,9 +3537,11 @@ reload (gpointer data)
   if (!g_file_get_contents (renderer->path, &text, NULL, NULL))
     g_error ("failed to load slides from %s\n", renderer->path);
 
-  renderer->rest_y = STARTPOS;
   pp_parse_slides (PINPOINT_RENDERER (renderer), text);
   g_free (text);
+  reset_rest_places (renderer);
+  renderer->speaker_previews = NULL; /* neighbouring slides might differ */
+  speaker_prefetch_thumbnails (renderer);
   show_slide(renderer, FALSE);
   reload_tag = 0;
   return FALSE;
@@ -2340,6 +3568,8 @@ static ClutterRenderer clutter_renderer_vtable =
       .run = clutter_renderer_run,
       .finalize = clutter_renderer_finalize,
       .make_point = clutter_renderer_make_point,
+      .prepare_point = clutter_renderer_prepare_point,
+      .release_point = clutter_renderer_release_point,
       .allocate_data = clutter_renderer_allocate_data,
       .free_data = clutter_renderer_free_data
     }
@@ -0,0 +1,178 @@
+/*
+ * Pinpoint: A small-ish presentation tool
+ *
+ * Copyright (C) 2010 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option0 any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks that the kernels pp_pixels_to_cairo () picks give the same pixels
+ * as the scalar loop, for every colour/alpha pair and for short rows of
+ * all widths, then times both on a large image:
+ *
+ *   pp-pixels-bench [WIDTH HEIGHT]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* for the scalar kernels and the ones picked for this CPU */
+#include "pp-pixels.c"
+
+#define RUNS 5
+
+static const char *
+kernel_name (PPPixelsRowFunc row)
+{
+  if (row == rgb_row_c || row == rgba_row_c)
+    return "scalar";
+#if defined(PP_PIXELS_X86)
+  if (row == rgba_row_sse2)
+    return "sse2";
+  if (row == rgb_row_ssse3)
+    return "ssse3";
+  if (row == rgb_row_avx2 || row == rgba_row_avx2)
+    return "avx2";
+#elif defined(PP_PIXELS_NEON)
+  if (row == rgb_row_neon || row == rgba_row_neon)
+    return "neon";
+#endif
+  return "?";
+}
+
+/* Converts the same rows with the scalar kernel and with row, from every
+ * start offset and for widths 1 to max_width, and compares the results
+ * byte for byte, guard pixels past the end included.
+ */
+static gboolean
+check_rows (PPPixelsRowFunc  row,
+            PPPixelsRowFunc  ref,
+            gint             bpp,
+            const guchar    *src,
+            gint             n_src,
+            gint             max_width)
+{
+  guint32 expected[max_width + 1], got[max_width + 1];
+  gint    width, offset;
+
+  for (width = 1; width <= max_width; width++)
+    for (offset = 0; offset + width <= n_src; offset += width)
+      {
+        memset (expected, 0x5a, sizeof (expected));
+        memset (got, 0x5a, sizeof (got));
+        ref (expected, src + offset * bpp, width);
+        row (got, src + offset * bpp, width);
+        if (memcmp (expected, got, sizeof (expected)) != 0)
+          {
+            g_printerr ("%s differs at width %d, pixel %d\n",
+                        bpp == 4 ? "RGBA" : "RGB", width, offset);
+            return FALSE;
+          }
+      }
+
+  return TRUE;
+}
+
+/* Best of RUNS conversions of a width by height image, in microseconds */
+static gint64
+time_image (PPPixelsRowFunc  row,
+            guchar          *dst,
+            const guchar    *src,
+            gint             bpp,
+            gint             width,
+            gint             height)
+{
+  gint64 best = G_MAXINT64;
+  gint   run, y;
+
+  for (run = 0; run < RUNS; run++)
+    {
+      gint64 start = g_get_monotonic_time (), elapsed;
+
+      for (y = 0; y < height; y++)
+        row ((guint32 *) (dst + (gsize) y * width * 4),
+             src + (gsize) y * width * bpp, width);
+
+      elapsed = g_get_monotonic_time () - start;
+      best = MIN (best, elapsed);
+    }
+
+  return best;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint     width = 4000, height = 3000;
+  guchar  *pairs, *src, *dst;
+  gsize    i;
+  gint     c, a;
+  gboolean ok = TRUE;
+
+  if (argc == 3)
+    {
+      width = atoi (argv[1]);
+      height = atoi (argv[2]);
+    }
+  if (width <= 0 || height <= 0)
+    {
+      g_printerr ("usage: %s [WIDTH HEIGHT]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  pp_pixels_init ();
+
+  /* every colour/alpha pair, in each channel */
+  pairs = g_malloc (256 * 256 * 4);
+  for (a = 0; a < 256; a++)
+    for (c = 0; c < 256; c++)
+      {
+        guchar *p = pairs + (a * 256 + c) * 4;
+
+        p[0] = c;
+        p[1] = 255 - c;
+        p[2] = c ^ 0x5a;
+        p[3] = a;
+      }
+
+  ok &= check_rows (rgba_row, rgba_row_c, 4, pairs, 256 * 256, 70);
+  ok &= check_rows (rgb_row, rgb_row_c, 3, pairs, 256 * 256 * 4 / 3, 70);
+  g_free (pairs);
+
+  if (!ok)
+    return EXIT_FAILURE;
+  g_print ("RGB kernel: %s, RGBA kernel: %s, output identical to the scalar "
+           "loop\n", kernel_name (rgb_row), kernel_name (rgba_row));
+
+  src = g_malloc ((gsize) width * height * 4);
+  dst = g_malloc ((gsize) width * height * 4);
+  for (i = 0; i < (gsize) width * height * 4; i++)
+    src[i] = g_random_int ();
+
+  g_print ("%dx%d, best of %d:\n", width, height, RUNS);
+  g_print ("  RGB   scalar %7.2f ms  %-6s %7.2f ms\n",
+           time_image (rgb_row_c, dst, src, 3, width, height) / 1000.,
+           kernel_name (rgb_row),
+           time_image (rgb_row, dst, src, 3, width, height) / 1000.);
+  g_print ("  RGBA  scalar %7.2f ms  %-6s %7.2f ms\n",
+           time_image (rgba_row_c, dst, src, 4, width, height) / 1000.,
+           kernel_name (rgba_row),
+           time_image (rgba_row, dst, src, 4, width, height) / 1000.);
+
+  g_free (src);
+  g_free (dst);
+
+  return EXIT_SUCCESS;
+}
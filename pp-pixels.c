@@ -0,0 +1,310 @@
+/*
+ * Pinpoint: A small-ish presentation tool
+ *
+ * Copyright (C) 2010 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option0 any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pp-pixels.h"
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define PP_PIXELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define PP_PIXELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* converts n pixels of a row */
+typedef void (*PPPixelsRowFunc) (guint32      *dst,
+                                 const guchar *src,
+                                 gint          n);
+
+/* c * a / 255, rounded, exact for all 8 bit c and a */
+#define MULT(d,c,a,t) G_STMT_START { t = c * a + 0x7f; d = ((t >> 8) + t) >> 8; } G_STMT_END
+
+/*
+ * Scalar, also handles what is left at the end of rows for the others
+ */
+
+static void
+rgb_row_c (guint32      *dst,
+           const guchar *src,
+           gint          n)
+{
+  for (; n > 0; n--, src += 3)
+    *dst++ = 0xff000000 | (src[0] << 16) | (src[1] << 8) | src[2];
+}
+
+static void
+rgba_row_c (guint32      *dst,
+            const guchar *src,
+            gint          n)
+{
+  guint t1, t2, t3, r, g, b;
+
+  for (; n > 0; n--, src += 4)
+    {
+      MULT (r, src[0], src[3], t1);
+      MULT (g, src[1], src[3], t2);
+      MULT (b, src[2], src[3], t3);
+      *dst++ = ((guint32) src[3] << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+#ifdef PP_PIXELS_X86
+
+/* In 16 bit lanes holding R G B A R G B A, premultiplies the colour lanes
+ * with MULT () and swaps R and B. The alpha lanes are multiplied by 255,
+ * which MULT () leaves as they are.
+ */
+static inline __m128i
+premultiply_sse2 (__m128i p)
+{
+  const __m128i bias        = _mm_set1_epi16 (0x7f);
+  const __m128i rgb_lanes   = _mm_set_epi16 (0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i alpha_lanes = _mm_set_epi16 (255, 0, 0, 0, 255, 0, 0, 0);
+  __m128i       a, t;
+
+  a = _mm_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+  a = _mm_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3));
+  a = _mm_or_si128 (_mm_and_si128 (a, rgb_lanes), alpha_lanes);
+
+  t = _mm_add_epi16 (_mm_mullo_epi16 (p, a), bias);
+  t = _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+
+  t = _mm_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+  return _mm_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+static void
+rgba_row_sse2 (guint32      *dst,
+               const guchar *src,
+               gint          n)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; n >= 4; n -= 4, src += 16, dst += 4)
+    {
+      __m128i v  = _mm_loadu_si128 ((const __m128i *) src);
+      __m128i lo = premultiply_sse2 (_mm_unpacklo_epi8 (v, zero));
+      __m128i hi = premultiply_sse2 (_mm_unpackhi_epi8 (v, zero));
+
+      _mm_storeu_si128 ((__m128i *) dst, _mm_packus_epi16 (lo, hi));
+    }
+
+  rgba_row_c (dst, src, n);
+}
+
+__attribute__ ((target ("ssse3")))
+static void
+rgb_row_ssse3 (guint32      *dst,
+               const guchar *src,
+               gint          n)
+{
+  const __m128i shuffle = _mm_setr_epi8 (2, 1, 0, -1, 5, 4, 3, -1,
+                                         8, 7, 6, -1, 11, 10, 9, -1);
+  const __m128i opaque  = _mm_set1_epi32 (0xff000000);
+
+  /* 4 pixels at a time, reading 16 bytes of which only 12 are used */
+  for (; n >= 6; n -= 4, src += 12, dst += 4)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) src);
+
+      v = _mm_or_si128 (_mm_shuffle_epi8 (v, shuffle), opaque);
+      _mm_storeu_si128 ((__m128i *) dst, v);
+    }
+
+  rgb_row_c (dst, src, n);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+rgb_row_avx2 (guint32      *dst,
+              const guchar *src,
+              gint          n)
+{
+  const __m256i shuffle = _mm256_setr_epi8 (2, 1, 0, -1, 5, 4, 3, -1,
+                                            8, 7, 6, -1, 11, 10, 9, -1,
+                                            2, 1, 0, -1, 5, 4, 3, -1,
+                                            8, 7, 6, -1, 11, 10, 9, -1);
+  const __m256i opaque  = _mm256_set1_epi32 (0xff000000);
+
+  /* 8 pixels at a time, 4 per 128 bit lane */
+  for (; n >= 10; n -= 8, src += 24, dst += 8)
+    {
+      __m256i v;
+
+      v = _mm256_castsi128_si256 (_mm_loadu_si128 ((const __m128i *) src));
+      v = _mm256_inserti128_si256 (v,
+                                   _mm_loadu_si128 ((const __m128i *)
+                                                    (src + 12)), 1);
+      v = _mm256_or_si256 (_mm256_shuffle_epi8 (v, shuffle), opaque);
+      _mm256_storeu_si256 ((__m256i *) dst, v);
+    }
+
+  rgb_row_ssse3 (dst, src, n);
+}
+
+/* premultiply_sse2 () on two 128 bit lanes at once */
+__attribute__ ((target ("avx2")))
+static inline __m256i
+premultiply_avx2 (__m256i p)
+{
+  const __m256i bias        = _mm256_set1_epi16 (0x7f);
+  const __m256i rgb_lanes   = _mm256_set_epi16 (0, -1, -1, -1, 0, -1, -1, -1,
+                                                0, -1, -1, -1, 0, -1, -1, -1);
+  const __m256i alpha_lanes = _mm256_set_epi16 (255, 0, 0, 0, 255, 0, 0, 0,
+                                                255, 0, 0, 0, 255, 0, 0, 0);
+  __m256i       a, t;
+
+  a = _mm256_shufflelo_epi16 (p, _MM_SHUFFLE (3, 3, 3, 3));
+  a = _mm256_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3));
+  a = _mm256_or_si256 (_mm256_and_si256 (a, rgb_lanes), alpha_lanes);
+
+  t = _mm256_add_epi16 (_mm256_mullo_epi16 (p, a), bias);
+  t = _mm256_srli_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), 8);
+
+  t = _mm256_shufflelo_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+  return _mm256_shufflehi_epi16 (t, _MM_SHUFFLE (3, 0, 1, 2));
+}
+
+__attribute__ ((target ("avx2")))
+static void
+rgba_row_avx2 (guint32      *dst,
+               const guchar *src,
+               gint          n)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+
+  /* unpacking and packing work within 128 bit lanes, so the pixel order
+   * is kept */
+  for (; n >= 8; n -= 8, src += 32, dst += 8)
+    {
+      __m256i v  = _mm256_loadu_si256 ((const __m256i *) src);
+      __m256i lo = premultiply_avx2 (_mm256_unpacklo_epi8 (v, zero));
+      __m256i hi = premultiply_avx2 (_mm256_unpackhi_epi8 (v, zero));
+
+      _mm256_storeu_si256 ((__m256i *) dst, _mm256_packus_epi16 (lo, hi));
+    }
+
+  rgba_row_sse2 (dst, src, n);
+}
+
+#endif /* PP_PIXELS_X86 */
+
+#ifdef PP_PIXELS_NEON
+
+static void
+rgb_row_neon (guint32      *dst,
+              const guchar *src,
+              gint          n)
+{
+  for (; n >= 16; n -= 16, src += 48, dst += 16)
+    {
+      uint8x16x3_t v = vld3q_u8 (src);
+      uint8x16x4_t o;
+
+      o.val[0] = v.val[2];
+      o.val[1] = v.val[1];
+      o.val[2] = v.val[0];
+      o.val[3] = vdupq_n_u8 (0xff);
+      vst4q_u8 ((uint8_t *) dst, o);
+    }
+
+  rgb_row_c (dst, src, n);
+}
+
+static void
+rgba_row_neon (guint32      *dst,
+               const guchar *src,
+               gint          n)
+{
+  const uint16x8_t bias = vdupq_n_u16 (0x7f);
+
+  for (; n >= 8; n -= 8, src += 32, dst += 8)
+    {
+      uint8x8x4_t v = vld4_u8 (src);
+      uint8x8x4_t o;
+      uint16x8_t  t;
+      gint        c;
+
+      for (c = 0; c < 3; c++)
+        {
+          t = vmlal_u8 (bias, v.val[c], v.val[3]);
+          o.val[2 - c] = vshrn_n_u16 (vsraq_n_u16 (t, t, 8), 8);
+        }
+      o.val[3] = v.val[3];
+      vst4_u8 ((uint8_t *) dst, o);
+    }
+
+  rgba_row_c (dst, src, n);
+}
+
+#endif /* PP_PIXELS_NEON */
+
+static PPPixelsRowFunc rgb_row  = rgb_row_c;
+static PPPixelsRowFunc rgba_row = rgba_row_c;
+
+static void
+pp_pixels_init (void)
+{
+  static gsize initialized = 0;
+
+  if (!g_once_init_enter (&initialized))
+    return;
+
+#if defined(PP_PIXELS_X86)
+  rgba_row = rgba_row_sse2;
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("ssse3"))
+    rgb_row = rgb_row_ssse3;
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      rgb_row = rgb_row_avx2;
+      rgba_row = rgba_row_avx2;
+    }
+#elif defined(PP_PIXELS_NEON)
+  rgb_row = rgb_row_neon;
+  rgba_row = rgba_row_neon;
+#endif
+
+  g_once_init_leave (&initialized, 1);
+}
+
+void
+pp_pixels_to_cairo (guchar       *dst,
+                    gint          dst_stride,
+                    const guchar *src,
+                    gint          src_stride,
+                    gint          width,
+                    gint          height,
+                    gboolean      has_alpha)
+{
+  PPPixelsRowFunc row;
+
+  pp_pixels_init ();
+  row = has_alpha ? rgba_row : rgb_row;
+
+  for (; height > 0; height--, dst += dst_stride, src += src_stride)
+    row ((guint32 *) dst, src, width);
+}
@@ -0,0 +1,38 @@
+/*
+ * Pinpoint: A small-ish presentation tool
+ *
+ * Copyright (C) 2010 Intel Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option0 any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PP_PIXELS_H__
+#define __PP_PIXELS_H__
+
+#include <glib.h>
+
+/* Converts rows of packed 8 bit RGB or non premultiplied RGBA pixels, as
+ * found in GdkPixbufs and GStreamer RGB buffers, to cairo's native endian
+ * CAIRO_FORMAT_RGB24 / premultiplied CAIRO_FORMAT_ARGB32 pixels. Uses
+ * SSE2, SSSE3, AVX2 or NEON where the CPU has them.
+ */
+void pp_pixels_to_cairo (guchar       *dst,
+                         gint          dst_stride,
+                         const guchar *src,
+                         gint          src_stride,
+                         gint          width,
+                         gint          height,
+                         gboolean      has_alpha);
+
+#endif